@@ -19,7 +19,11 @@
 #include "config.h"
 #include "workspace.h"
 #include "spaces.h"
+#include "finder.h"
 #include "plumb.h"
+#include "layout.h"
+#include "monitor.h"
+#include "confcache.h"
 
 char *version[] = {
 	"shrub9 version 1.0.0, Copyright (c) 2025 shrub (based on 9wm)", 0,
@@ -54,6 +58,7 @@ int num_screens;
 char *activestr;
 char *inactivestr;
 #endif
+static char *fname;	/* -font, which a reloaded config does not override */
 
 Atom exit_9wm;
 Atom restart_9wm;
@@ -66,6 +71,8 @@ Atom wm_colormaps;
 Atom wm_moveresize;
 Atom net_wm_state;
 Atom net_wm_state_fullscreen;
+Atom net_wm_sync_request;
+Atom net_wm_sync_request_counter;
 Atom active_window;
 Atom utf8_string;
 Atom _9wm_running;
@@ -121,8 +128,10 @@ int
 main(int argc, char *argv[])
 {
 	int i, do_exit, do_restart;
-	char *fname;
 	int shape_event, dummy;
+#ifdef	DEBUG
+	long start = mstime();
+#endif
 	myargv = argv;		/* for restart */
 
 	do_exit = do_restart = 0;
@@ -241,6 +250,8 @@ main(int argc, char *argv[])
 	active_window = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
 	net_wm_state = XInternAtom(dpy, "_NET_WM_STATE",False);
 	net_wm_state_fullscreen = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
+	net_wm_sync_request = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+	net_wm_sync_request_counter = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER", False);
 	utf8_string = XInternAtom(dpy, "UTF8_STRING", False);
 	_9wm_running = XInternAtom(dpy, "_9WM_RUNNING", False);
 	_9wm_hold_mode = XInternAtom(dpy, "_9WM_HOLD_MODE", False);
@@ -303,7 +314,7 @@ main(int argc, char *argv[])
 		}
 		
 		printf("[MAIN DEBUG] Loading config font: %s\n", config.font);
-		if (!config_load_font_hybrid(config.font)) {
+		if ((font = confcache_font()) == 0 && !config_load_font_hybrid(config.font)) {
 			fprintf(stderr, "shrub9: fatal: cannot load any font\n");
 			exit(1);
 		}
@@ -332,6 +343,8 @@ main(int argc, char *argv[])
 #ifdef	SHAPE
 	shape = XShapeQueryExtension(dpy, &shape_event, &dummy);
 #endif
+	thumb_init();
+	opaque_init();
 
 	num_screens = ScreenCount(dpy);
 	screens = (ScreenInfo *) malloc(sizeof(ScreenInfo) * num_screens);
@@ -346,20 +359,13 @@ main(int argc, char *argv[])
 	for (i = 0; i < num_screens; i++) {
 		initscreen(&screens[i], i);
 		spaces_init(&screens[i]);
-		
-		/* Register workspace key bindings */
-		if (config.workspaces.enabled) {
-			int j;
-			for (j = 0; j < config.workspaces.count; j++) {
-				KeyCode keycode = XKeysymToKeycode(dpy, config.workspaces.switch_keys[j].keysym);
-				if (keycode != 0) {
-					XGrabKey(dpy, keycode, config.workspaces.switch_keys[j].modifiers,
-						screens[i].root, True, GrabModeAsync, GrabModeAsync);
-				}
-			}
-		}
+		grabkeys(&screens[i]);
 	}
 
+	monitor_init();
+	config_watch();
+	confcache_done(fname ? 0 : font, activestr == 0 && inactivestr == 0);
+
 	/* Apply wallpaper if configured */
 	config_apply_wallpaper();
 
@@ -376,12 +382,44 @@ main(int argc, char *argv[])
 
 	for (i = 0; i < num_screens; i++)
 		scanwins(&screens[i]);
+#ifdef	DEBUG
+	XSync(dpy, False);
+	fprintf(stderr, "9wm: startup %ld ms\n", mstime() - start);
+#endif
 
 	mainloop(shape_event);
 
 	return 0;
 }
 
+#ifdef XFT
+/* Text colours for Xft, matching s->menu_fg and s->menu_bg */
+static void
+xftcolors(ScreenInfo * s)
+{
+	XColor xcolor;
+	XRenderColor render_color;
+
+	/* Normal text color */
+	xcolor.pixel = s->menu_fg;
+	XQueryColor(dpy, s->def_cmap, &xcolor);
+	render_color.red = xcolor.red;
+	render_color.green = xcolor.green;
+	render_color.blue = xcolor.blue;
+	render_color.alpha = 0xFFFF;
+	XftColorAllocValue(dpy, DefaultVisual(dpy, s->num), s->def_cmap, &render_color, &s->xft_color);
+
+	/* Highlight text color */
+	xcolor.pixel = s->menu_bg;
+	XQueryColor(dpy, s->def_cmap, &xcolor);
+	render_color.red = xcolor.red;
+	render_color.green = xcolor.green;
+	render_color.blue = xcolor.blue;
+	render_color.alpha = 0xFFFF;
+	XftColorAllocValue(dpy, DefaultVisual(dpy, s->num), s->def_cmap, &render_color, &s->xft_highlight_color);
+}
+#endif
+
 void
 initscreen(ScreenInfo * s, int i)
 {
@@ -389,6 +427,7 @@ initscreen(ScreenInfo * s, int i)
 	unsigned long mask;
 	XGCValues gv;
 	XSetWindowAttributes attr;
+	int j;
 
 	s->num = i;
 	s->root = RootWindow(dpy, i);
@@ -410,49 +449,7 @@ initscreen(ScreenInfo * s, int i)
 
 	s->black = BlackPixel(dpy, i);
 	s->white = WhitePixel(dpy, i);
-	/*
-	 * Setup color for border
-	 */
-	s->active = s->black;
-	s->inactive = s->white;
-	s->menu_bg = s->white;
-	s->menu_fg = s->black;
-	s->frame_color = s->black;
-#ifdef COLOR
-	{
-		Colormap cmap = DefaultColormap(dpy,s->num);
-		unsigned long active, inactive, menu_bg, menu_fg, frame_color;
-		
-		if (cmap != 0) {
-			if (activestr != NULL && getcolor(cmap, &active, activestr)) {
-				s->active = active;
-			} else if (config_parse_color(config.active_color, &active, cmap)) {
-				s->active = active;
-			}
-			
-			if (inactivestr != NULL && getcolor(cmap, &inactive, inactivestr)) {
-				s->inactive = inactive;
-			} else if (config_parse_color(config.inactive_color, &inactive, cmap)) {
-				s->inactive = inactive;
-			}
-			
-			/* Set menu colors from config */
-			if (config_parse_color(config.menu_bg_color, &menu_bg, cmap)) {
-				s->menu_bg = menu_bg;
-			}
-			if (config_parse_color(config.menu_fg_color, &menu_fg, cmap)) {
-				s->menu_fg = menu_fg;
-			}
-			
-			/* Set frame color from config */
-			if (config_parse_color(config.window_frame_color, &frame_color, cmap)) {
-				s->frame_color = frame_color;
-			} else {
-				s->frame_color = s->black;  /* Default to black */
-			}
-		}
-	}
-#endif
+	setcolors(s);
 	/* Create XOR graphics context for drawing bounds/highlights */
 	gv.foreground = s->black;
 	gv.background = s->white;
@@ -462,6 +459,14 @@ initscreen(ScreenInfo * s, int i)
 	mask = GCForeground | GCBackground | GCFunction | GCLineWidth | GCSubwindowMode;
 	s->gc = XCreateGC(dpy, s->root, mask, &gv);
 	
+	/* Plain drawing and pixmap copies, without NoExpose events */
+	gv.foreground = s->menu_fg;
+	gv.background = s->menu_bg;
+	gv.function = GXcopy;
+	gv.graphics_exposures = False;
+	mask = GCForeground | GCBackground | GCFunction | GCGraphicsExposures;
+	s->copy_gc = XCreateGC(dpy, s->root, mask, &gv);
+	
 	/* Create normal graphics context for text rendering */
 	gv.foreground = s->menu_fg;
 	gv.background = s->menu_bg;
@@ -515,28 +520,7 @@ initscreen(ScreenInfo * s, int i)
 		if (!s->xft_draw) {
 			printf("[XFT DEBUG] Failed to create XftDraw for screen %d\n", s->num);
 		} else {
-			/* Set up Xft colors using proper color querying */
-			XColor xcolor;
-			XRenderColor render_color;
-			
-			/* Normal text color */
-			xcolor.pixel = s->menu_fg;
-			XQueryColor(dpy, s->def_cmap, &xcolor);
-			render_color.red = xcolor.red;
-			render_color.green = xcolor.green;
-			render_color.blue = xcolor.blue;
-			render_color.alpha = 0xFFFF;
-			XftColorAllocValue(dpy, DefaultVisual(dpy, i), s->def_cmap, &render_color, &s->xft_color);
-			
-			/* Highlight text color */
-			xcolor.pixel = s->menu_bg;
-			XQueryColor(dpy, s->def_cmap, &xcolor);
-			render_color.red = xcolor.red;
-			render_color.green = xcolor.green;
-			render_color.blue = xcolor.blue;
-			render_color.alpha = 0xFFFF;
-			XftColorAllocValue(dpy, DefaultVisual(dpy, i), s->def_cmap, &render_color, &s->xft_highlight_color);
-			
+			xftcolors(s);
 			printf("[XFT DEBUG] Created XftDraw and colors for screen %d\n", s->num);
 		}
 	}
@@ -551,14 +535,224 @@ initscreen(ScreenInfo * s, int i)
 	XChangeWindowAttributes(dpy, s->root, mask, &attr);
 	XSync(dpy, False);
 
-	s->menuwin = XCreateSimpleWindow(dpy, s->root, 0, 0, 1, 1, 1, s->menu_fg, s->menu_bg);
-	s->submenuwin = XCreateSimpleWindow(dpy, s->root, 0, 0, 1, 1, 1, s->menu_fg, s->menu_bg);
+	s->menuwin = XCreateSimpleWindow(dpy, s->root, 0, 0, 1, 1, MENUBORDER, s->menu_fg, s->menu_bg);
+	s->submenuwin = XCreateSimpleWindow(dpy, s->root, 0, 0, 1, 1, MENUBORDER, s->menu_fg, s->menu_bg);
+	memset(&s->menustrip, 0, sizeof(s->menustrip));
+	memset(&s->substrip, 0, sizeof(s->substrip));
+	for (j = 0; j < 4; j++) {
+		attr.override_redirect = True;
+		attr.background_pixel = s->menu_fg;
+		s->bound[j] = XCreateWindow(dpy, s->root, 0, 0, 1, 1, 0, CopyFromParent,
+		                            InputOutput, CopyFromParent,
+		                            CWOverrideRedirect | CWBackPixel, &attr);
+	}
+	s->bound_mapped = 0;
+	s->nmonitors = 0;
 	
 	/* Set override redirect on submenu to prevent WM interference */
 	attr.override_redirect = True;
 	XChangeWindowAttributes(dpy, s->submenuwin, CWOverrideRedirect, &attr);
 }
 
+/* Frame and menu colours of s, from the command line, the config cache or the config */
+void
+setcolors(ScreenInfo * s)
+{
+	s->active = s->black;
+	s->inactive = s->white;
+	s->menu_bg = s->white;
+	s->menu_fg = s->black;
+	s->frame_color = s->black;
+#ifdef COLOR
+	{
+		Colormap cmap = DefaultColormap(dpy,s->num);
+		unsigned long active, inactive, menu_bg, menu_fg, frame_color;
+		
+		if (activestr == NULL && inactivestr == NULL && confcache_colors(s))
+			return;
+		if (cmap != 0) {
+			if (activestr != NULL && getcolor(cmap, &active, activestr)) {
+				s->active = active;
+			} else if (config_parse_color(config.active_color, &active, cmap)) {
+				s->active = active;
+			}
+			
+			if (inactivestr != NULL && getcolor(cmap, &inactive, inactivestr)) {
+				s->inactive = inactive;
+			} else if (config_parse_color(config.inactive_color, &inactive, cmap)) {
+				s->inactive = inactive;
+			}
+			
+			/* Set menu colors from config */
+			if (config_parse_color(config.menu_bg_color, &menu_bg, cmap)) {
+				s->menu_bg = menu_bg;
+			}
+			if (config_parse_color(config.menu_fg_color, &menu_fg, cmap)) {
+				s->menu_fg = menu_fg;
+			}
+			
+			/* Set frame color from config */
+			if (config_parse_color(config.window_frame_color, &frame_color, cmap)) {
+				s->frame_color = frame_color;
+			} else {
+				s->frame_color = s->black;  /* Default to black */
+			}
+		}
+	}
+#endif
+}
+
+/* Grab the finder and workspace keys on the root of s */
+void
+grabkeys(ScreenInfo * s)
+{
+	KeyCode keycode;
+	int j;
+
+	/* Register the finder key binding */
+	if (config.finder_key.keysym != NoSymbol) {
+		keycode = XKeysymToKeycode(dpy, config.finder_key.keysym);
+		if (keycode != 0)
+			XGrabKey(dpy, keycode, config.finder_key.modifiers,
+				s->root, True, GrabModeAsync, GrabModeAsync);
+	}
+	
+	/* Register workspace key bindings */
+	if (config.workspaces.enabled) {
+		for (j = 0; j < config.workspaces.count; j++) {
+			keycode = XKeysymToKeycode(dpy, config.workspaces.switch_keys[j].keysym);
+			if (keycode != 0) {
+				XGrabKey(dpy, keycode, config.workspaces.switch_keys[j].modifiers,
+					s->root, True, GrabModeAsync, GrabModeAsync);
+			}
+		}
+	}
+}
+
+static void
+freestrip(MenuStrip *ms)
+{
+	if (ms->normal != None) {
+		XFreePixmap(dpy, ms->normal);
+		XFreePixmap(dpy, ms->highlight);
+	}
+	free(ms->text);
+	memset(ms, 0, sizeof(MenuStrip));
+}
+
+/*
+ * The config file was reloaded over old; diff says what changed (see
+ * config_diff()).  Apply just that to the running screens and clients.
+ */
+void
+reconfigure(Config *old, int diff)
+{
+	XFontStruct *ofont;
+#ifdef XFT
+	XftFont *oxft;
+	int ouse_xft;
+#endif
+	ScreenInfo *s;
+	Client *c;
+	unsigned long bg;
+	int i, j, fontok;
+
+	fontok = fname == 0;
+	if ((diff & ConfigFont) && fname != 0)
+		diff &= ~ConfigFont;	/* -font wins */
+	if (diff & ConfigFont) {
+		ofont = font;
+#ifdef XFT
+		oxft = xft_font;
+		ouse_xft = use_xft;
+		xft_font = NULL;	/* Closed below, once the new one is in */
+#endif
+		if (config_load_font_hybrid(config.font)) {
+			if (ofont != 0 && ofont != font)
+				XFreeFont(dpy, ofont);
+#ifdef XFT
+			if (oxft != NULL && oxft != xft_font)
+				XftFontClose(dpy, oxft);
+#endif
+		} else {
+			fprintf(stderr, "shrub9: can't load font %s, keeping the old one\n", config.font);
+			fontok = 0;
+			font = ofont;
+#ifdef XFT
+			xft_font = oxft;
+			use_xft = ouse_xft;
+#endif
+			diff &= ~ConfigFont;
+		}
+	}
+
+	for (i = 0; i < num_screens; i++) {
+		s = &screens[i];
+		if (diff & ConfigKeys) {
+			XUngrabKey(dpy, AnyKey, AnyModifier, s->root);
+			grabkeys(s);
+		}
+		if (diff & ConfigColors) {
+			setcolors(s);
+			XSetForeground(dpy, s->copy_gc, s->menu_fg);
+			XSetBackground(dpy, s->copy_gc, s->menu_bg);
+			XSetForeground(dpy, s->text_gc, s->menu_fg);
+			XSetBackground(dpy, s->text_gc, s->menu_bg);
+			XSetForeground(dpy, s->menu_highlight_gc, s->menu_fg);
+			XSetBackground(dpy, s->menu_highlight_gc, s->menu_bg);
+			XSetForeground(dpy, s->menu_highlight_text_gc, s->menu_bg);
+			XSetBackground(dpy, s->menu_highlight_text_gc, s->menu_fg);
+			XSetWindowBorder(dpy, s->menuwin, s->menu_fg);
+			XSetWindowBackground(dpy, s->menuwin, s->menu_bg);
+			XSetWindowBorder(dpy, s->submenuwin, s->menu_fg);
+			XSetWindowBackground(dpy, s->submenuwin, s->menu_bg);
+			for (j = 0; j < 4; j++)
+				XSetWindowBackground(dpy, s->bound[j], s->menu_fg);
+		}
+		if ((diff & ConfigFont) && font != 0) {
+			XSetFont(dpy, s->text_gc, font->fid);
+			XSetFont(dpy, s->menu_highlight_text_gc, font->fid);
+		}
+#ifdef XFT
+		if (use_xft && s->xft_draw == NULL) {
+			s->xft_draw = XftDrawCreate(dpy, s->menuwin, DefaultVisual(dpy, s->num), s->def_cmap);
+			if (s->xft_draw)
+				xftcolors(s);
+		} else if (s->xft_draw && (diff & ConfigColors)) {
+			XftColorFree(dpy, DefaultVisual(dpy, s->num), s->def_cmap, &s->xft_color);
+			XftColorFree(dpy, DefaultVisual(dpy, s->num), s->def_cmap, &s->xft_highlight_color);
+			xftcolors(s);
+		}
+#endif
+		/* Menus are drawn again from their strips, the strips from scratch */
+		if (diff & (ConfigColors | ConfigFont)) {
+			freestrip(&s->menustrip);
+			freestrip(&s->substrip);
+		}
+	}
+
+	if (diff & ConfigMenu)
+		rebuild_menu();
+
+	if (diff & (ConfigColors | ConfigFont)) {
+		for (c = clients; c; c = c->next) {
+			if (c->parent == c->screen->root)
+				continue;
+			XSetWindowBorder(dpy, c->parent, c->screen->frame_color);
+			if (c->titlebar != None) {
+				if (!config_parse_color(config.titlebar_bg_color, &bg, c->screen->def_cmap))
+					bg = c->screen->white;
+				XSetWindowBackground(dpy, c->titlebar, bg);
+			}
+			draw_border(c, c == current);
+		}
+		spaces_reset();
+		finder_reset();
+	}
+	confcache_save(fontok ? font : 0, activestr == 0 && inactivestr == 0);
+	XFlush(dpy);
+}
+
 ScreenInfo *
 getscreen(Window w)
 {
@@ -631,14 +825,30 @@ sighandler(void)
 	signalled = 1;
 }
 
+/*
+ * Replies read while working in the idle loop may have brought events in
+ * with them, which select() on the socket will not see: take one of those.
+ */
+static int
+queued(XEvent * e)
+{
+	if (QLength(dpy) == 0)
+		return 0;
+	XNextEvent(dpy, e);
+	return 1;
+}
+
 void
 getevent(XEvent * e)
 {
-	int fd;
+	int fd, cfd, n, timeout, lt;
 	fd_set rfds;
-	struct timeval t;
+	struct timeval t, *tp;
 
 	if (!signalled) {
+		/* Events never let up: do not hold a relayout back forever */
+		if (layout_timeout() == 0)
+			layout_flush();
 		if (QLength(dpy) > 0) {
 			XNextEvent(dpy, e);
 			return;
@@ -651,16 +861,54 @@ getevent(XEvent * e)
 			XNextEvent(dpy, e);
 			return;
 		}
+		/* Nothing to do: keep the hidden spaces overview up to date */
+		spaces_prerender();
 		XFlush(dpy);
+		if (queued(e))
+			return;
 
-		do {
+		for (;;) {
+			/* Wake up for throttled spaces thumbnail refreshes and settled relayouts */
+			tp = NULL;
+			timeout = spaces_refresh_timeout();
+			if ((lt = layout_timeout()) >= 0 && (timeout < 0 || lt < timeout))
+				timeout = lt;
+			if (timeout >= 0) {
+				t.tv_sec = timeout / 1000;
+				t.tv_usec = (timeout % 1000) * 1000;
+				tp = &t;
+			}
 			FD_ZERO(&rfds);
 			FD_SET(fd, &rfds);
-			if (select(fd + 1, &rfds, NULL, NULL, NULL) == 1) {
+			/* Only looked at when idle: a config edit can wait for a quiet moment */
+			cfd = config_watch_fd;
+			if (cfd >= 0)
+				FD_SET(cfd, &rfds);
+			n = select((cfd > fd ? cfd : fd) + 1, &rfds, NULL, NULL, tp);
+			if (n > 0 && cfd >= 0 && FD_ISSET(cfd, &rfds)) {
+				if (config_changed())
+					config_reload();
+				if (queued(e))
+					return;
+				if (!FD_ISSET(fd, &rfds))
+					continue;
+			}
+			if (n > 0) {
 				XNextEvent(dpy, e);
 				return;
 			}
-		} while (errno == EINTR);
+			if (n == 0) {
+				if (spaces_refresh_timeout() == 0)
+					spaces_refresh();
+				layout_flush();
+				XFlush(dpy);
+				if (queued(e))
+					return;
+				continue;
+			}
+			if (errno != EINTR)
+				break;
+		}
 		if (!signalled) {
 			perror("9wm: select failed");
 			exit(1);
@@ -671,6 +919,15 @@ getevent(XEvent * e)
 	exit(1);
 }
 
+long
+mstime(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return t.tv_sec * 1000L + t.tv_usec / 1000;
+}
+
 void
 cleanup(void)
 {
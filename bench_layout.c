@@ -0,0 +1,230 @@
+/*
+ * Microbenchmark for the tiling layouts (make bench)
+ * Copyright multiple authors, see README for licence details
+ *
+ * Times every layout, size hints included, on 1 to 5000 synthetic
+ * clients.  With DISPLAY set (a headless Xvfb will do) it also creates
+ * that many windows and counts the requests and bytes a relayout sends.
+ * Results go to stdout as JSON, one object per run, for comparing
+ * releases.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include "dat.h"
+#include "fns.h"
+#include "workspace.h"
+#include "layout.h"
+#include "monitor.h"
+
+/* What layout.o needs from the rest of the window manager */
+Display *dpy;
+ScreenInfo *screens;
+int num_screens;
+Client *clients;
+Client *current;
+int _border = 4;
+Workspace workspaces[MAX_WORKSPACES];
+
+static int counts[] = { 1, 2, 10, 100, 1000, 5000 };
+#define NCOUNTS	((int) (sizeof(counts) / sizeof(counts[0])))
+#define MAXCLIENTS	5000
+
+static double
+now(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec / 1e6;
+}
+
+long
+mstime(void)
+{
+	return (long) (now() * 1000);
+}
+
+/* Only layout_arrange() asks about monitors, and it is not run here */
+Monitor *
+monitor_of(Client *c)
+{
+	return 0;
+}
+
+void
+monitor_update(ScreenInfo *s)
+{
+}
+
+/* As in 9wm.c */
+void
+sendconfig(Client *c)
+{
+	XConfigureEvent ce;
+
+	ce.type = ConfigureNotify;
+	ce.event = c->window;
+	ce.window = c->window;
+	ce.x = c->x;
+	ce.y = c->y;
+	ce.width = c->dx;
+	ce.height = c->dy;
+	ce.border_width = c->border;
+	ce.above = None;
+	ce.override_redirect = 0;
+	XSendEvent(dpy, c->window, False, StructureNotifyMask, (XEvent *) & ce);
+}
+
+/* Every other client is a terminal, with xterm's base size and increments */
+static void
+makeclients(Client *cs, Client **cl, int n)
+{
+	int i;
+
+	memset(cs, 0, n * sizeof(Client));
+	for (i = 0; i < n; i++) {
+		cs[i].state = NormalState;
+		cs[i].x = cs[i].y = -1;
+		if (i & 1) {
+			cs[i].size.flags = PBaseSize | PResizeInc | PMinSize;
+			cs[i].size.base_width = cs[i].size.base_height = 4;
+			cs[i].size.width_inc = 6;
+			cs[i].size.height_inc = 13;
+			cs[i].size.min_width = 10;
+			cs[i].size.min_height = 17;
+			cs[i].min_dx = cs[i].min_dy = 4;
+		}
+		cl[i] = &cs[i];
+	}
+}
+
+static void
+compute(int l, Client **cl, int n, LayoutBox *area, LayoutBox *box)
+{
+	int i;
+
+	layouts[l].arrange(cl, n, area, box);
+	for (i = 0; i < n; i++)
+		layout_hints(cl[i], &box[i]);
+}
+
+/* Microseconds per layout, running for at least a tenth of a second */
+static double
+run(int l, Client **cl, int n, LayoutBox *area, LayoutBox *box)
+{
+	double start, t;
+	int k;
+
+	start = now();
+	k = 0;
+	do {
+		compute(l, cl, n, area, box);
+		k++;
+	} while ((t = now() - start) < 0.1);
+	return t * 1e6 / k;
+}
+
+/* Bytes this process has written so far, sockets included; -1 if unknown */
+static long
+written(void)
+{
+	FILE *f;
+	char line[128];
+	long v;
+
+	if ((f = fopen("/proc/self/io", "r")) == 0)
+		return -1;
+	v = -1;
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "wchar: %ld", &v) == 1)
+			break;
+	fclose(f);
+	return v;
+}
+
+/*
+ * Commit box to the windows and count what went to the server.  The
+ * XSync() adds one GetInputFocus request of 4 bytes, taken off again.
+ */
+static void
+commit(Client **cl, LayoutBox *box, int n, long *requests, long *bytes, double *us)
+{
+	unsigned long serial;
+	long w;
+	double start;
+
+	serial = XNextRequest(dpy);
+	w = written();
+	start = now();
+	layout_commit(cl, box, n);
+	XSync(dpy, False);
+	*us = (now() - start) * 1e6;
+	*requests = (long) (XNextRequest(dpy) - serial) - 1;
+	*bytes = w < 0 ? -1 : written() - w - 4;
+}
+
+int
+main(void)
+{
+	static Client cs[MAXCLIENTS];
+	static Client *cl[MAXCLIENTS];
+	static LayoutBox box[MAXCLIENTS];
+	LayoutBox area;
+	Window root;
+	long requests, bytes;
+	double us;
+	int l, i, j, n, first;
+
+	area.x = area.y = 0;
+	area.dx = 1920;
+	area.dy = 1080;
+	printf("{\"bench\": \"layout\", \"screen\": [%d, %d], \"compute\": [\n", area.dx, area.dy);
+	for (first = 1, l = 0; l < nlayouts; l++) {
+		for (j = 0; j < NCOUNTS; j++) {
+			n = counts[j];
+			makeclients(cs, cl, n);
+			printf("%s  {\"layout\": \"%s\", \"clients\": %d, \"us\": %.3f}",
+			       first ? "" : ",\n", layouts[l].name, n, run(l, cl, n, &area, box));
+			first = 0;
+		}
+	}
+	printf("\n],\n");
+
+	if ((dpy = XOpenDisplay(NULL)) == 0) {
+		printf("\"x\": null}\n");
+		return 0;
+	}
+	root = DefaultRootWindow(dpy);
+	printf("\"x\": {\"display\": \"%s\", \"relayout\": [\n", DisplayString(dpy));
+	for (first = 1, l = 0; l < nlayouts; l++) {
+		for (j = 0; j < NCOUNTS; j++) {
+			n = counts[j];
+			makeclients(cs, cl, n);
+			for (i = 0; i < n; i++) {
+				cs[i].parent = XCreateSimpleWindow(dpy, root, 0, 0, 1, 1, 0, 0, 0);
+				cs[i].window = XCreateSimpleWindow(dpy, cs[i].parent, 0, 0, 1, 1, 0, 0, 0);
+			}
+			XSync(dpy, False);
+
+			compute(l, cl, n, &area, box);
+			commit(cl, box, n, &requests, &bytes, &us);
+			printf("%s  {\"layout\": \"%s\", \"clients\": %d, "
+			       "\"requests\": %ld, \"bytes\": %ld, \"us\": %.1f}",
+			       first ? "" : ",\n", layouts[l].name, n, requests, bytes, us);
+			first = 0;
+
+			for (i = 0; i < n; i++)
+				XDestroyWindow(dpy, cs[i].parent);
+			XSync(dpy, False);
+		}
+	}
+	printf("\n]}}\n");
+	XCloseDisplay(dpy);
+	return 0;
+}
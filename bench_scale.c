@@ -0,0 +1,86 @@
+/*
+ * Microbenchmark for the thumbnail scaler (make bench)
+ * Copyright multiple authors, see README for licence details
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "scale.h"
+
+typedef void (*Scaler)(const unsigned int *, int, int, int, unsigned int *, int, int, int);
+
+static struct {
+	int sw, sh, dw, dh;
+} sizes[] = {
+	{ 640, 480, 160, 120 },
+	{ 1280, 720, 240, 135 },
+	{ 1920, 1080, 320, 180 },
+	{ 2560, 1440, 320, 180 },
+	{ 3840, 2160, 480, 270 },
+};
+
+static double
+now(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return t.tv_sec + t.tv_usec / 1e6;
+}
+
+/* Milliseconds per call, running for at least a quarter second */
+static double
+run(Scaler f, unsigned int *src, int sw, int sh, unsigned int *dst, int dw, int dh)
+{
+	double start, t;
+	int n;
+
+	start = now();
+	n = 0;
+	do {
+		f(src, sw, sh, sw, dst, dw, dh, dw);
+		n++;
+	} while ((t = now() - start) < 0.25);
+	return t * 1000 / n;
+}
+
+int
+main(void)
+{
+	unsigned int *src, *dst, *ref, seed;
+	double g, v;
+	int i, j, d, maxdiff, maxsrc;
+
+	maxsrc = 3840 * 2160;
+	src = (unsigned int *) malloc(maxsrc * sizeof(unsigned int));
+	dst = (unsigned int *) malloc(480 * 270 * sizeof(unsigned int));
+	ref = (unsigned int *) malloc(480 * 270 * sizeof(unsigned int));
+	if (src == 0 || dst == 0 || ref == 0) {
+		fprintf(stderr, "bench_scale: out of memory\n");
+		return 1;
+	}
+	for (seed = 1, i = 0; i < maxsrc; i++) {
+		seed = seed * 1103515245 + 12345;
+		src[i] = seed;
+	}
+
+	printf("%-22s %10s %10s %8s %8s\n", "size", "generic", "scale_box", "speedup", "maxdiff");
+	for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		g = run(scale_box_generic, src, sizes[i].sw, sizes[i].sh, ref, sizes[i].dw, sizes[i].dh);
+		v = run(scale_box, src, sizes[i].sw, sizes[i].sh, dst, sizes[i].dw, sizes[i].dh);
+
+		/* Rounding differs slightly between the two, by at most one */
+		maxdiff = 0;
+		for (j = 0; j < sizes[i].dw * sizes[i].dh * 4; j++) {
+			d = ((unsigned char *) dst)[j] - ((unsigned char *) ref)[j];
+			if (d < 0)
+				d = -d;
+			if (d > maxdiff)
+				maxdiff = d;
+		}
+		printf("%4dx%-4d -> %4dx%-4d %8.3fms %8.3fms %7.2fx %8d\n",
+		       sizes[i].sw, sizes[i].sh, sizes[i].dw, sizes[i].dh, g, v, g / v, maxdiff);
+	}
+	return 0;
+}
@@ -61,7 +61,7 @@ draw_titlebar(Client * c)
 {
 	unsigned long titlebar_fg;
 	char *title;
-	int title_len, text_width, text_x, text_y;
+	int title_len, width, text_x, text_y;
 	GC titlebar_gc;
 	XGCValues gv;
 	
@@ -95,8 +95,8 @@ draw_titlebar(Client * c)
 		gv.font = font->fid;
 		titlebar_gc = XCreateGC(dpy, c->titlebar, GCForeground | GCBackground | GCFont, &gv);
 		
-		text_width = XTextWidth(font, title, title_len);
-		text_x = (c->dx - text_width) / 2;
+		width = text_width(title);
+		text_x = (c->dx - width) / 2;
 		if (text_x < 4) text_x = 4;
 		text_y = font->ascent + 2;
 		
@@ -156,6 +156,9 @@ active(Client * c)
 	while (c->revert && !normal(c->revert))
 		c->revert = c->revert->revert;
 	current = c;
+	/* The focused head is now c's, and so is the current workspace */
+	if (c->workspace >= 0)
+		current_workspace = c->workspace;
 #ifdef	DEBUG
 	if (debug)
 		dump_revert();
@@ -292,6 +295,10 @@ rmclient(Client * c)
 
 	/* Destroy titlebar if it exists */
 	destroy_titlebar(c);
+	
+	/* Stop tracking damage before the frame goes away */
+	thumb_free(c);
+	finder_remove(c);
 
 	if (c->parent != c->screen->root)
 		XDestroyWindow(dpy, c->parent);
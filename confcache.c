@@ -0,0 +1,243 @@
+/*
+ * Binary config cache for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ *
+ * Startup reads the config file, then resolves each colour with
+ * XParseColor and XAllocColor and probes the server for a font, a round
+ * trip each.  Once that is done the result is written to config.cache
+ * next to the config: the pixels each screen ended up with and the full
+ * name of the core font that loaded.  While the config file's mtime (to
+ * the nanosecond), size and inode still match, the next start maps the
+ * cache and takes those from it instead.  Pixels are only kept for
+ * TrueColor visuals, where a colour's pixel follows from the visual's
+ * masks alone and nothing has to be allocated in the colormap; the masks
+ * are recorded and checked.
+ * The file itself is still parsed each time: that takes microseconds,
+ * less than mapping a copy of Config would.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include "dat.h"
+#include "fns.h"
+#include "config.h"
+#include "confcache.h"
+
+#define CONFCACHE_MAGIC "shrub9c"
+
+typedef struct CacheHeader CacheHeader;
+typedef struct CacheScreen CacheScreen;
+
+/* The file is a CacheHeader, then one CacheScreen per screen */
+struct CacheHeader {
+	char magic[8];
+	int version;
+	long mtime;		/* Of the config file it was made from */
+	long mtime_nsec;	/* An edit within the same second still shows */
+	long size;
+	long inode;
+	int nscreens;
+	char font[CONFIG_MAX_STRING];	/* Core font that loaded, or empty */
+};
+
+struct CacheScreen {
+	int truecolor;		/* Else the pixels are not kept */
+	int depth;
+	unsigned long red_mask, green_mask, blue_mask;
+	unsigned long active, inactive, menu_bg, menu_fg, frame_color;
+};
+
+static char cache_path[CONFIG_MAX_STRING + 8];
+static char *map;		/* The cache, while startup still needs it */
+static size_t maplen;
+static CacheHeader *header;
+static CacheScreen *cscreens;
+static int warm;
+static int missed;	/* Something the cache held could not be used */
+
+static void
+confcache_unmap(void)
+{
+	if (map != 0)
+		munmap(map, maplen);
+	map = 0;
+	header = 0;
+	cscreens = 0;
+}
+
+static void
+confcache_setpath(void)
+{
+	snprintf(cache_path, sizeof(cache_path), "%s.cache", config.config_path);
+}
+
+/*
+ * Map the cache if it was made from the config file as it is now.
+ * Returns 0 when there is no such cache.
+ */
+int
+confcache_load(void)
+{
+	struct stat st, cst;
+	int fd;
+
+	confcache_unmap();
+	confcache_setpath();
+	if (stat(config.config_path, &st) < 0)
+		return 0;
+	if ((fd = open(cache_path, O_RDONLY)) < 0)
+		return 0;
+	if (fstat(fd, &cst) < 0 || cst.st_size < (off_t) sizeof(CacheHeader)) {
+		close(fd);
+		return 0;
+	}
+	map = mmap(0, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		map = 0;
+		return 0;
+	}
+	maplen = cst.st_size;
+	header = (CacheHeader *) map;
+	if (memcmp(header->magic, CONFCACHE_MAGIC, sizeof(header->magic)) != 0 ||
+	    header->version != CONFCACHE_VERSION ||
+	    header->mtime != (long) st.st_mtime || header->mtime_nsec != st.st_mtim.tv_nsec ||
+	    header->size != (long) st.st_size ||
+	    header->inode != (long) st.st_ino || header->nscreens < 0 ||
+	    maplen != sizeof(CacheHeader) + header->nscreens * sizeof(CacheScreen)) {
+		confcache_unmap();
+		return 0;
+	}
+	cscreens = (CacheScreen *) (map + sizeof(CacheHeader));
+	warm = 1;
+	return 1;
+}
+
+/* Fill in the pixels of s from the cache; 0 if they have to be allocated */
+int
+confcache_colors(ScreenInfo *s)
+{
+	Visual *v;
+	CacheScreen *cs;
+
+	if (cscreens == 0 || s->num >= header->nscreens)
+		return 0;
+	cs = &cscreens[s->num];
+	v = DefaultVisual(dpy, s->num);
+	if (!cs->truecolor || v->class != TrueColor || cs->depth != DefaultDepth(dpy, s->num) ||
+	    cs->red_mask != v->red_mask || cs->green_mask != v->green_mask ||
+	    cs->blue_mask != v->blue_mask) {
+		missed = 1;
+		return 0;
+	}
+	s->active = cs->active;
+	s->inactive = cs->inactive;
+	s->menu_bg = cs->menu_bg;
+	s->menu_fg = cs->menu_fg;
+	s->frame_color = cs->frame_color;
+	return 1;
+}
+
+/* The core font that loaded last time, loaded by its full name, or 0 */
+XFontStruct *
+confcache_font(void)
+{
+	XFontStruct *f;
+
+	if (header == 0 || header->font[0] == '\0')
+		return 0;
+	if ((f = XLoadQueryFont(dpy, header->font)) == 0)
+		missed = 1;
+	return f;
+}
+
+/*
+ * Write the cache for the config as it is now.  f is the font loaded for
+ * config.font, 0 if it was not (-font, an Xft font); pixels says whether
+ * the screens' colours came from the config alone.
+ */
+void
+confcache_save(XFontStruct *f, int pixels)
+{
+	CacheHeader h;
+	CacheScreen cs;
+	struct stat st;
+	char tmp[CONFIG_MAX_STRING + 16];
+	char *name;
+	unsigned long v;
+	Visual *vis;
+	FILE *fp;
+	int i, ok;
+
+	confcache_setpath();
+	if (stat(config.config_path, &st) < 0)
+		return;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CONFCACHE_MAGIC, sizeof(h.magic));
+	h.version = CONFCACHE_VERSION;
+	h.mtime = st.st_mtime;
+	h.mtime_nsec = st.st_mtim.tv_nsec;
+	h.size = st.st_size;
+	h.inode = st.st_ino;
+	h.nscreens = num_screens;
+	if (f != 0 && XGetFontProperty(f, XA_FONT, &v) && (name = XGetAtomName(dpy, v)) != 0) {
+		strncpy(h.font, name, sizeof(h.font) - 1);
+		XFree(name);
+	}
+
+	/* Written aside and renamed, so a start never maps half a cache */
+	snprintf(tmp, sizeof(tmp), "%s.%d", cache_path, (int) getpid());
+	if ((fp = fopen(tmp, "w")) == 0)
+		return;
+	ok = fwrite(&h, sizeof(h), 1, fp) == 1;
+	for (i = 0; ok && i < num_screens; i++) {
+		memset(&cs, 0, sizeof(cs));
+		vis = DefaultVisual(dpy, i);
+		if (pixels && vis->class == TrueColor) {
+			cs.truecolor = 1;
+			cs.depth = DefaultDepth(dpy, i);
+			cs.red_mask = vis->red_mask;
+			cs.green_mask = vis->green_mask;
+			cs.blue_mask = vis->blue_mask;
+			cs.active = screens[i].active;
+			cs.inactive = screens[i].inactive;
+			cs.menu_bg = screens[i].menu_bg;
+			cs.menu_fg = screens[i].menu_fg;
+			cs.frame_color = screens[i].frame_color;
+		}
+		ok = fwrite(&cs, sizeof(cs), 1, fp) == 1;
+	}
+	if (fclose(fp) != 0)
+		ok = 0;
+	if (!ok || rename(tmp, cache_path) < 0) {
+		fprintf(stderr, "shrub9: can't write %s\n", cache_path);
+		unlink(tmp);
+	}
+}
+
+/*
+ * Startup is over: drop the map, and write the cache for next time unless
+ * everything came from it.  Later colour and font changes come from a
+ * reload, which resolves them afresh and saves again.
+ */
+void
+confcache_done(XFontStruct *f, int pixels)
+{
+#ifdef	DEBUG
+	fprintf(stderr, "confcache: %s start\n", warm && !missed ? "warm" : "cold");
+#endif
+	confcache_unmap();
+	if (!warm || missed)
+		confcache_save(f, pixels);
+	warm = missed = 0;
+}
@@ -0,0 +1,21 @@
+/*
+ * Binary config cache for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ */
+
+#ifndef CONFCACHE_H
+#define CONFCACHE_H
+
+#include <X11/Xlib.h>
+
+/* Bump whenever the file layout changes */
+#define CONFCACHE_VERSION 2
+
+/* Function prototypes */
+int confcache_load(void);
+int confcache_colors(ScreenInfo *s);
+XFontStruct* confcache_font(void);
+void confcache_save(XFontStruct *f, int pixels);
+void confcache_done(XFontStruct *f, int pixels);
+
+#endif /* CONFCACHE_H */
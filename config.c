@@ -9,6 +9,9 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 #include <ctype.h>
 #include <pwd.h>
 #include <X11/X.h>
@@ -18,8 +21,11 @@
 #include "config.h"
 #include "dat.h"
 #include "fns.h"
+#include "layout.h"
+#include "confcache.h"
 
 Config config = {0};
+int config_watch_fd = -1;
 
 static char* trim_whitespace(char *str);
 static int parse_key_value(char *line, char *key, char *value, int max_len);
@@ -52,7 +58,10 @@ config_init(void)
 	snprintf(config.config_path, CONFIG_MAX_STRING, "%s/.config/shrub9/config", home);
 	
 	if (access(config.config_path, R_OK) == 0) {
-		return config_load(config.config_path);
+		if (!config_load(config.config_path))
+			return 0;
+		confcache_load();
+		return 1;
 	} else {
 		char config_dir[CONFIG_MAX_STRING];
 		snprintf(config_dir, CONFIG_MAX_STRING, "%s/.config/shrub9", home);
@@ -136,6 +145,8 @@ config_load(const char *path)
 			} else {
 				config.border_width = border_width;
 			}
+		} else if (strcmp(key, "opaque_move") == 0) {
+			config.opaque_move = atoi(value);
 		} else if (strcmp(key, "window_frame_width") == 0) {
 			int frame_width = atoi(value);
 			if (frame_width < 0) {
@@ -254,6 +265,37 @@ config_load(const char *path)
 			config.wallpaper_enabled = 1;
 		} else if (strcmp(key, "wallpaper_enabled") == 0) {
 			config.wallpaper_enabled = atoi(value);
+		} else if (strcmp(key, "spaces_refresh_ms") == 0) {
+			int refresh_ms = atoi(value);
+			if (refresh_ms < 0) {
+				fprintf(stderr, "shrub9: config error at line %d: spaces_refresh_ms cannot be negative (got %d)\n", line_num, refresh_ms);
+			} else {
+				config.spaces_refresh_ms = refresh_ms;
+			}
+		} else if (strcmp(key, "thumb_cache_kb") == 0) {
+			int cache_kb = atoi(value);
+			if (cache_kb < 0) {
+				fprintf(stderr, "shrub9: config error at line %d: thumb_cache_kb cannot be negative (got %d)\n", line_num, cache_kb);
+			} else {
+				config.thumb_cache_kb = cache_kb;
+			}
+		} else if (strcmp(key, "finder_key") == 0) {
+			char *plus = strchr(value, '+');
+			if (plus) {
+				*plus = '\0';
+				config.finder_key.modifiers = parse_modifiers(value);
+				config.finder_key.keysym = parse_keysym(plus + 1);
+			} else {
+				fprintf(stderr, "shrub9: config error at line %d: finder key binding '%s' missing '+' separator (expected format: modifier+key)\n", line_num, value);
+			}
+		} else if (strcmp(key, "tile_layout") == 0) {
+			if (layout_find(value) < 0) {
+				fprintf(stderr, "shrub9: config error at line %d: unknown tile_layout '%s'\n", line_num, value);
+			} else {
+				strncpy(config.tile_layout, value, CONFIG_MAX_STRING - 1);
+			}
+		} else if (strcmp(key, "auto_tile") == 0) {
+			config.auto_tile = atoi(value);
 		} else if (strcmp(key, "plumb_enabled") == 0) {
 			config.plumb_enabled = atoi(value);
 		} else if (strcmp(key, "plumb_send_path") == 0) {
@@ -286,6 +328,189 @@ config_free(void)
 	memset(&config, 0, sizeof(config));
 }
 
+/*
+ * Watch the config file's directory, since editors tend to write a new
+ * file and rename it over the old one.  config_watch_fd stays -1 where
+ * inotify is missing, and then a change still needs a restart.
+ */
+void
+config_watch(void)
+{
+#ifdef __linux__
+	char dir[CONFIG_MAX_STRING];
+	char *slash;
+
+	strncpy(dir, config.config_path, sizeof(dir) - 1);
+	dir[sizeof(dir) - 1] = '\0';
+	if ((slash = strrchr(dir, '/')) == NULL)
+		return;
+	*slash = '\0';
+	config_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (config_watch_fd < 0) {
+		perror("shrub9: inotify_init1");
+		return;
+	}
+	if (inotify_add_watch(config_watch_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		fprintf(stderr, "shrub9: cannot watch %s for config changes\n", dir);
+		close(config_watch_fd);
+		config_watch_fd = -1;
+	}
+#endif
+}
+
+/* Drain config_watch_fd; whether the config file itself was written */
+int
+config_changed(void)
+{
+#ifdef __linux__
+	char buf[4096], *p, *name;
+	struct inotify_event *ev;
+	ssize_t n;
+	int changed;
+
+	if (config_watch_fd < 0)
+		return 0;
+	name = strrchr(config.config_path, '/') + 1;
+	changed = 0;
+	while ((n = read(config_watch_fd, buf, sizeof(buf))) > 0) {
+		for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + ev->len) {
+			ev = (struct inotify_event *) p;
+			if (ev->len > 0 && strcmp(ev->name, name) == 0)
+				changed = 1;
+		}
+	}
+	return changed;
+#else
+	return 0;
+#endif
+}
+
+static int
+keys_equal(KeyBind *a, KeyBind *b)
+{
+	return a->modifiers == b->modifiers && a->keysym == b->keysym;
+}
+
+static int
+menu_items_equal(MenuConfig *a, MenuConfig *b, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (strcmp(a[i].label, b[i].label) != 0 || strcmp(a[i].command, b[i].command) != 0 ||
+		    a[i].is_folder != b[i].is_folder || a[i].submenu_count != b[i].submenu_count)
+			return 0;
+		if (a[i].submenu_count > 0 && a[i].submenu_items && b[i].submenu_items &&
+		    !menu_items_equal(a[i].submenu_items, b[i].submenu_items, a[i].submenu_count))
+			return 0;
+	}
+	return 1;
+}
+
+/* Which of the things reconfigure() can apply differ between old and config */
+int
+config_diff(Config *old)
+{
+	int i, diff;
+
+	diff = 0;
+	if (strcmp(old->active_color, config.active_color) != 0 ||
+	    strcmp(old->inactive_color, config.inactive_color) != 0 ||
+	    strcmp(old->menu_bg_color, config.menu_bg_color) != 0 ||
+	    strcmp(old->menu_fg_color, config.menu_fg_color) != 0 ||
+	    strcmp(old->window_frame_color, config.window_frame_color) != 0 ||
+	    strcmp(old->titlebar_bg_color, config.titlebar_bg_color) != 0 ||
+	    strcmp(old->titlebar_fg_color, config.titlebar_fg_color) != 0)
+		diff |= ConfigColors;
+
+	if (!keys_equal(&old->finder_key, &config.finder_key))
+		diff |= ConfigKeys;
+	for (i = 0; i < config.workspaces.count && !(diff & ConfigKeys); i++)
+		if (!keys_equal(&old->workspaces.switch_keys[i], &config.workspaces.switch_keys[i]))
+			diff |= ConfigKeys;
+
+	if (old->menu_count != config.menu_count || old->lower != config.lower ||
+	    !menu_items_equal(old->menu_items, config.menu_items, config.menu_count))
+		diff |= ConfigMenu;
+
+	if (strcmp(old->font, config.font) != 0)
+		diff |= ConfigFont;
+	return diff;
+}
+
+static void
+restart_needed(const char *key)
+{
+	fprintf(stderr, "shrub9: %s changed, restart to apply it\n", key);
+}
+
+/*
+ * Settings that are only read at startup, or when a window is first
+ * framed: say which of those changed.  The workspace count stays as it
+ * was, since the workspaces themselves are only made at startup, and
+ * the switch keys grabbed have to match it.
+ */
+static void
+config_restart_only(Config *old)
+{
+	if (old->workspaces.count != config.workspaces.count ||
+	    old->workspaces.enabled != config.workspaces.enabled) {
+		restart_needed("workspace_count");
+		config.workspaces.count = old->workspaces.count;
+		config.workspaces.enabled = old->workspaces.enabled;
+	}
+	if (old->border_width != config.border_width)
+		restart_needed("border_width");
+	if (old->inset_width != config.inset_width)
+		restart_needed("inset_width");
+	if (old->window_frame_width != config.window_frame_width)
+		restart_needed("window_frame_width");
+	if (old->show_titlebars != config.show_titlebars)
+		restart_needed("show_titlebars");
+	if (old->titlebar_height != config.titlebar_height)
+		restart_needed("titlebar_height");
+	if (strcmp(old->tile_layout, config.tile_layout) != 0)
+		restart_needed("tile_layout");
+	if (old->auto_tile != config.auto_tile)
+		restart_needed("auto_tile");
+	if (strcmp(old->cursor_style, config.cursor_style) != 0)
+		restart_needed("cursor_style");
+	if (old->wallpaper_enabled != config.wallpaper_enabled ||
+	    strcmp(old->wallpaper_path, config.wallpaper_path) != 0)
+		restart_needed("wallpaper");
+	if (old->plumb_enabled != config.plumb_enabled ||
+	    strcmp(old->plumb_send_path, config.plumb_send_path) != 0)
+		restart_needed("plumb");
+}
+
+/*
+ * Read the config file again into a fresh Config and hand the old one to
+ * reconfigure(), which applies only what changed.  Nothing is
+ * re-managed.  A file that cannot be read leaves everything as it was.
+ */
+void
+config_reload(void)
+{
+	Config old;
+	int i;
+
+	old = config;
+	memset(&config, 0, sizeof(config));
+	strcpy(config.config_path, old.config_path);
+	config_set_defaults();
+	if (!config_load(config.config_path)) {
+		for (i = 0; i < CONFIG_MAX_MENU_ITEMS; i++)
+			free_menu_item(&config.menu_items[i]);
+		config = old;
+		return;
+	}
+	fprintf(stderr, "shrub9: reloaded %s\n", config.config_path);
+	config_restart_only(&old);
+	reconfigure(&old, config_diff(&old));
+	for (i = 0; i < CONFIG_MAX_MENU_ITEMS; i++)
+		free_menu_item(&old.menu_items[i]);
+}
+
 int
 config_get_workspace_key(KeySym keysym, unsigned int modifiers)
 {
@@ -542,6 +767,9 @@ config_load_font_hybrid(const char *requested_font)
 		return 0;
 	}
 	
+	/* Measured widths belong to the old font */
+	text_cache_flush();
+	
 #ifdef XFT
 	/* First try Xft for TTF fonts */
 	if (is_ttf_font_name(requested_font)) {
@@ -619,6 +847,7 @@ config_set_defaults(void)
 	strncpy(config.terminal_classes, DEFAULT_TERMINAL_CLASSES, CONFIG_MAX_STRING - 1);
 	
 	config.border_width = DEFAULT_BORDER_WIDTH;
+	config.opaque_move = DEFAULT_OPAQUE_MOVE;
 	config.window_frame_width = DEFAULT_WINDOW_FRAME_WIDTH;
 	strncpy(config.window_frame_color, DEFAULT_WINDOW_FRAME_COLOR, CONFIG_MAX_STRING - 1);
 	config.inset_width = DEFAULT_INSET_WIDTH;
@@ -637,6 +866,15 @@ config_set_defaults(void)
 	config.wallpaper_enabled = 0;
 	strncpy(config.wallpaper_path, "", CONFIG_MAX_STRING - 1);
 	
+	config.spaces_refresh_ms = DEFAULT_SPACES_REFRESH_MS;
+	config.thumb_cache_kb = DEFAULT_THUMB_CACHE_KB;
+	
+	config.finder_key.modifiers = DEFAULT_FINDER_MOD;
+	config.finder_key.keysym = XK_slash;
+	
+	strncpy(config.tile_layout, DEFAULT_TILE_LAYOUT, CONFIG_MAX_STRING - 1);
+	config.auto_tile = DEFAULT_AUTO_TILE;
+	
 	config.plumb_enabled = DEFAULT_PLUMB_ENABLED;
 	strncpy(config.plumb_send_path, DEFAULT_PLUMB_SEND_PATH, CONFIG_MAX_STRING - 1);
 	
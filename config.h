@@ -11,7 +11,7 @@
 #define CONFIG_MAX_STRING 256
 #define CONFIG_MAX_MENU_ITEMS 32
 #define CONFIG_MAX_SUBMENU_ITEMS 16
-#define CONFIG_MAX_WORKSPACES 10
+#define CONFIG_MAX_WORKSPACES 128
 #define CONFIG_MAX_KEYBINDS 64
 
 typedef struct KeyBind KeyBind;
@@ -57,6 +57,7 @@ struct Config {
 	
 	/* Behavior */
 	int border_width;
+	int opaque_move;
 	int window_frame_width;
 	char window_frame_color[CONFIG_MAX_STRING];
 	int inset_width;
@@ -80,6 +81,17 @@ struct Config {
 	char wallpaper_path[CONFIG_MAX_STRING];
 	int wallpaper_enabled;
 	
+	/* Spaces */
+	int spaces_refresh_ms;
+	int thumb_cache_kb;
+	
+	/* Finder */
+	KeyBind finder_key;
+	
+	/* Tiling */
+	char tile_layout[CONFIG_MAX_STRING];
+	int auto_tile;
+	
 	/* Plumber */
 	int plumb_enabled;
 	char plumb_send_path[CONFIG_MAX_STRING];
@@ -93,14 +105,27 @@ struct Config {
 	char config_path[CONFIG_MAX_STRING];
 };
 
+/* What config_diff() found changed, for reconfigure() */
+enum {
+	ConfigColors = 1,
+	ConfigKeys = 2,
+	ConfigMenu = 4,
+	ConfigFont = 8
+};
+
 /* Global configuration instance */
 extern Config config;
+extern int config_watch_fd;
 
 /* Function prototypes */
 int config_init(void);
 int config_load(const char *path);
 int config_load_default(void);
 void config_free(void);
+void config_watch(void);
+int config_changed(void);
+void config_reload(void);
+int config_diff(Config *old);
 int config_get_workspace_key(KeySym keysym, unsigned int modifiers);
 const char* config_get_menu_command(int index);
 const char* config_get_menu_label(int index);
@@ -124,11 +149,13 @@ int is_terminal_class(const char *class_name);
 #define DEFAULT_TERMINAL "xterm"
 #define DEFAULT_CURSOR "modern"
 #define DEFAULT_BORDER_WIDTH 4
+#define DEFAULT_OPAQUE_MOVE 0
 #define DEFAULT_WINDOW_FRAME_WIDTH 0
 #define DEFAULT_WINDOW_FRAME_COLOR "#000000"
 #define DEFAULT_INSET_WIDTH 1
 #define DEFAULT_WORKSPACE_COUNT 4
 #define DEFAULT_WORKSPACE_MOD Mod4Mask
+#define DEFAULT_FINDER_MOD Mod4Mask
 #define DEFAULT_SHOW_TITLEBARS 0
 #define DEFAULT_TITLEBAR_HEIGHT 18
 #define DEFAULT_TITLEBAR_BG_COLOR "#cccccc"
@@ -136,6 +163,10 @@ int is_terminal_class(const char *class_name);
 #define DEFAULT_LOWER 0
 #define DEFAULT_TERMINAL_LAUNCHER_MODE 1
 #define DEFAULT_TERMINAL_CLASSES "st,st-256color,alacritty,xterm,urxvt,kitty,gnome-terminal,xfce4-terminal,konsole"
+#define DEFAULT_SPACES_REFRESH_MS 100
+#define DEFAULT_THUMB_CACHE_KB 16384
+#define DEFAULT_TILE_LAYOUT "master"
+#define DEFAULT_AUTO_TILE 0
 #define DEFAULT_PLUMB_ENABLED 0
 #define DEFAULT_PLUMB_SEND_PATH "/mnt/plumb/send"
 
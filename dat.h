@@ -11,6 +11,9 @@
 #define	INSET		_inset
 #define MAXHIDDEN	32
 #define B3FIXED 	5
+#define MENUBORDER	1
+#define BOUNDWIDTH	2
+#define MAXMONITORS	16
 
 #define AllButtonMask	(Button1Mask|Button2Mask|Button3Mask \
 			|Button4Mask|Button5Mask)
@@ -24,6 +27,8 @@ typedef struct Client Client;
 typedef struct Menu Menu;
 typedef struct SubMenu SubMenu;
 typedef struct ScreenInfo ScreenInfo;
+typedef struct MenuStrip MenuStrip;
+typedef struct Monitor Monitor;
 
 struct Client {
 	Window		window;
@@ -78,6 +83,19 @@ struct Client {
 	
 	/* Drag offset support for better window moving */
 	int		drag_offset_x, drag_offset_y;
+	
+	/* Spaces thumbnail support */
+	XID		damage;
+	unsigned long	damage_gen;
+	int		thumb_dirty;
+	XRectangle	thumb_rect;	/* Where spaces last drew it, for hit tests */
+	struct ThumbEntry *thumb_entry;	/* Cached thumbnail, see thumb.c */
+	
+	/* Opaque resize pacing, see opaque.c */
+	XID		sync_counter;
+	
+	/* Finder support */
+	struct FinderEntry *finder_entry;	/* Its line in the finder index, see finder.c */
 };
 
 #define hidden(c)	((c)->state == IconicState)
@@ -87,6 +105,7 @@ struct Client {
 /* c->proto */
 #define Pdelete 	1
 #define Ptakefocus	2
+#define Psyncrequest	4
 
 struct Menu {
 	char	**item;
@@ -102,16 +121,42 @@ struct SubMenu {
 	int	parent_item;
 };
 
+/* A menu rendered once, normal and highlighted, for copying rows from */
+struct MenuStrip {
+	Pixmap	normal;
+	Pixmap	highlight;
+	int	n, wide, high;
+	int	lower;		/* config.lower when drawn */
+	unsigned long	sig;	/* Of the items it was drawn from */
+	char	*text;		/* Those items, each ending in a NUL */
+};
+
+/* One head of a screen, in root coordinates; see monitor.c */
+struct Monitor {
+	int	x, y, width, height;
+	int	workspace;	/* Shown on this head, see workspace.c */
+};
+
 struct ScreenInfo {
 	int		num;
 	Window		root;
 	Window		menuwin;
 	Window		submenuwin;
+	int		menu_x, menu_y;		/* Where menuhit() last put menuwin */
+	unsigned int	menu_w, menu_h;
 	int		submenu_x, submenu_y;
 	unsigned int	submenu_w, submenu_h;
+	MenuStrip	menustrip;
+	MenuStrip	substrip;
+	Window		bound[4];	/* Rubber-band outline: top, bottom, left, right */
+	int		bound_mapped;
+	Monitor		monitors[MAXMONITORS];
+	int		nmonitors;
+	struct SpacesView *spaces;	/* Its own overview, see spaces.c */
 	Colormap	def_cmap;
 	GC		gc;
 	GC		text_gc;
+	GC		copy_gc;
 	GC		menu_highlight_gc;
 	GC		menu_highlight_text_gc;
 #ifdef XFT
@@ -181,6 +226,8 @@ extern Atom		wm_moveresize;
 extern Atom		active_window;
 extern Atom		net_wm_state;
 extern Atom		net_wm_state_fullscreen;
+extern Atom		net_wm_sync_request;
+extern Atom		net_wm_sync_request_counter;
 
 /* client.c */
 extern Client		*clients;
@@ -194,3 +241,12 @@ extern Menu 		b3menu;
 
 /* error.c */
 extern int 		ignore_badwindow;
+
+/* grab.c */
+extern int		modal;
+
+/* opaque.c */
+extern int		opaque_alarm_event;
+
+/* monitor.c */
+extern int		monitor_event;
@@ -14,121 +14,144 @@
 #include "config.h"
 #include "workspace.h"
 #include "spaces.h"
+#include "thumb.h"
+#include "monitor.h"
+
+static int shape_event_type;
 
 void
 mainloop(int shape_event)
 {
 	XEvent ev;
 
+	shape_event_type = shape_event;
 	for (;;) {
 		getevent(&ev);
 		
 		/* Safety check for workspace switching state */
 		workspace_check_switching_state();
 
+		dispatch(&ev);
+	}
+}
+
+/*
+ * Handle one event.  Besides mainloop(), the modal loops in grab.c
+ * hand over everything that is not theirs, so other clients are still
+ * looked after while a menu or a sweep is up.
+ */
+void
+dispatch(XEvent * ev)
+{
 #ifdef	DEBUG_EV
-		if (debug) {
-			ShowEvent(&ev);
-			printf("\n");
-		}
+	if (debug) {
+		ShowEvent(ev);
+		printf("\n");
+	}
 #endif
-		switch (ev.type) {
-		default:
+	switch (ev->type) {
+	default:
 #ifdef	SHAPE
-			if (shape && ev.type == shape_event)
-				shapenotify((XShapeEvent *) & ev);
-			else
+		if (shape && ev->type == shape_event_type)
+			shapenotify((XShapeEvent *) ev);
+		else
 #endif
-				fprintf(stderr, "9wm: unknown ev.type %d\n", ev.type);
-			break;
-		case ButtonPress:
-			button(&ev.xbutton);
-			break;
-		case ButtonRelease:
-			if (spaces_mode && ev.xbutton.window == spaces_view.overlay) {
-				spaces_handle_button(&ev.xbutton);
-			}
-			break;
-		case KeyPress:
-			if (spaces_mode && ev.xkey.window == spaces_view.overlay) {
-				spaces_handle_key(&ev.xkey);
-			} else {
-				keypress(&ev.xkey);
-			}
-			break;
-		case KeyRelease:
-			/* Ignore key releases */
-			break;
-		case MapRequest:
-			mapreq(&ev.xmaprequest);
-			break;
-		case ConfigureRequest:
-			configurereq(&ev.xconfigurerequest);
-			break;
-		case CirculateRequest:
-			circulatereq(&ev.xcirculaterequest);
-			break;
-		case UnmapNotify:
-			unmap(&ev.xunmap);
-			break;
-		case CreateNotify:
-			newwindow(&ev.xcreatewindow);
-			break;
-		case DestroyNotify:
-			destroy(ev.xdestroywindow.window);
-			break;
-		case ClientMessage:
-			clientmesg(&ev.xclient);
-			break;
-		case ColormapNotify:
-			cmap(&ev.xcolormap);
-			break;
-		case PropertyNotify:
-			property(&ev.xproperty);
-			break;
-		case SelectionClear:
-			fprintf(stderr, "9wm: SelectionClear (this should not happen)\n");
-			break;
-		case SelectionNotify:
-			fprintf(stderr, "9wm: SelectionNotify (this should not happen)\n");
-			break;
-		case SelectionRequest:
-			fprintf(stderr, "9wm: SelectionRequest (this should not happen)\n");
-			break;
-		case EnterNotify:
-			enter(&ev.xcrossing);
-			break;
-		case ReparentNotify:
-			reparent(&ev.xreparent);
-			break;
-		case FocusIn:
-			focusin(&ev.xfocus);
-			break;
-		case MotionNotify:
-			if (spaces_mode && ev.xmotion.window == spaces_view.overlay) {
-				spaces_handle_motion(&ev.xmotion);
-			}
-			break;
-		case FocusOut:
-		case ConfigureNotify:
-		case MapNotify:
-		case MappingNotify:
-			/*
-			 * not interested 
-			 */
-			trace("ignore", 0, &ev);
-			break;
-		case Expose:
-			if (spaces_mode && ev.xexpose.window == spaces_view.overlay) {
-				spaces_draw();
-			} else {
-				Client *c = getclient(ev.xexpose.window, 0);
-				if (c && c->titlebar == ev.xexpose.window) {
-					draw_titlebar(c);
-				}
+		if (thumb_enabled && ev->type == thumb_damage_event)
+			spaces_damage(ev);
+		else if (ev->type == opaque_alarm_event)
+			;	/* Late answer to a resize that has already ended */
+		else if (ev->type == monitor_event)
+			monitor_screenchange(ev);
+		else
+			fprintf(stderr, "9wm: unknown ev.type %d\n", ev->type);
+		break;
+	case ButtonPress:
+		button(&ev->xbutton);
+		break;
+	case ButtonRelease:
+		if (spaces_mode && ev->xbutton.window == spaces_view->overlay) {
+			spaces_handle_button(&ev->xbutton);
+		}
+		break;
+	case KeyPress:
+		if (spaces_mode && ev->xkey.window == spaces_view->overlay) {
+			spaces_handle_key(&ev->xkey);
+		} else {
+			keypress(&ev->xkey);
+		}
+		break;
+	case KeyRelease:
+		/* Ignore key releases */
+		break;
+	case MapRequest:
+		mapreq(&ev->xmaprequest);
+		break;
+	case ConfigureRequest:
+		configurereq(&ev->xconfigurerequest);
+		break;
+	case CirculateRequest:
+		circulatereq(&ev->xcirculaterequest);
+		break;
+	case UnmapNotify:
+		unmap(&ev->xunmap);
+		break;
+	case CreateNotify:
+		newwindow(&ev->xcreatewindow);
+		break;
+	case DestroyNotify:
+		destroy(ev->xdestroywindow.window);
+		break;
+	case ClientMessage:
+		clientmesg(&ev->xclient);
+		break;
+	case ColormapNotify:
+		cmap(&ev->xcolormap);
+		break;
+	case PropertyNotify:
+		property(&ev->xproperty);
+		break;
+	case SelectionClear:
+		fprintf(stderr, "9wm: SelectionClear (this should not happen)\n");
+		break;
+	case SelectionNotify:
+		fprintf(stderr, "9wm: SelectionNotify (this should not happen)\n");
+		break;
+	case SelectionRequest:
+		fprintf(stderr, "9wm: SelectionRequest (this should not happen)\n");
+		break;
+	case EnterNotify:
+		enter(&ev->xcrossing);
+		break;
+	case ReparentNotify:
+		reparent(&ev->xreparent);
+		break;
+	case FocusIn:
+		focusin(&ev->xfocus);
+		break;
+	case MotionNotify:
+		if (spaces_mode && ev->xmotion.window == spaces_view->overlay) {
+			spaces_handle_motion(&ev->xmotion);
+		}
+		break;
+	case FocusOut:
+	case ConfigureNotify:
+	case MapNotify:
+	case MappingNotify:
+		/*
+		 * not interested 
+		 */
+		trace("ignore", 0, ev);
+		break;
+	case Expose:
+		if (spaces_mode && ev->xexpose.window == spaces_view->overlay) {
+			spaces_expose(&ev->xexpose);
+		} else {
+			Client *c = getclient(ev->xexpose.window, 0);
+			if (c && c->titlebar == ev->xexpose.window) {
+				draw_titlebar(c);
 			}
-			break;
 		}
+		break;
 	}
 }
 
@@ -433,6 +456,7 @@ property(XPropertyEvent * e)
 		c->iconname = delete ? 0 : getprop(c->window, a);
 		setlabel(c);
 		renamec(c, c->label);
+		finder_update(c);
 		return;
 	case XA_WM_NAME:
 		if (c->name != 0)
@@ -440,6 +464,7 @@ property(XPropertyEvent * e)
 		c->name = delete ? 0 : getprop(c->window, a);
 		setlabel(c);
 		renamec(c, c->label);
+		finder_update(c);
 		return;
 	case XA_WM_TRANSIENT_FOR:
 		gettrans(c);
@@ -455,6 +480,8 @@ property(XPropertyEvent * e)
 			cmapfocus(c);
 	} else if (a == wm_protocols) {
 		getproto(c);
+	} else if (a == net_wm_sync_request_counter) {
+		opaque_getcounter(c);
 	}
 }
 
@@ -556,21 +583,27 @@ keypress(XKeyEvent * e)
 	
 	/* Handle spaces overlay key presses */
 	if (spaces_mode) {
-		if (e->window == spaces_view.overlay) {
+		if (e->window == spaces_view->overlay) {
 			spaces_handle_key(e);
 			return;
 		} else {
 			/* Safety check: if spaces_mode is on but event is not for overlay, 
 			   something is wrong - reset spaces mode */
 			spaces_mode = 0;
-			spaces_view.active = 0;
+			spaces_view->active = 0;
 		}
 	}
 	
 	keysym = XLookupKeysym(e, 0);
 	
+	if (keysym == config.finder_key.keysym && e->state == config.finder_key.modifiers &&
+	    keysym != NoSymbol) {
+		finder_show(getscreen(e->root));
+		return;
+	}
+	
 	workspace = config_get_workspace_key(keysym, e->state);
 	if (workspace >= 0) {
-		workspace_switch(workspace);
+		workspace_switch(getscreen(e->root), workspace);
 	}
 }
@@ -0,0 +1,418 @@
+/*
+ * Window finder for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ *
+ * Every managed client has an entry holding its label, name, class and
+ * instance, lowercased, kept current from manage() and property().  A
+ * query is matched against these as a prefix of any field, then as a
+ * substring, then as a subsequence within one field.  Each entry also
+ * carries a bit per character class it contains, so most entries are
+ * rejected with one AND.  Typing another character only narrows the
+ * previous matches; only deleting one rescans the whole index.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+#include "dat.h"
+#include "fns.h"
+#include "workspace.h"
+#include "finder.h"
+#include "monitor.h"
+
+static FinderEntry **entries;
+static int nentries, maxentries;
+
+static FinderEntry **match;
+static int nmatch;
+
+static char query[FINDER_QUERY_MAX];
+static int qlen;
+static unsigned long qmask;
+static int sel, first;
+static int finder_open;
+
+static ScreenInfo *finder_screen;
+static Window finder_win = None;
+static Pixmap finder_buf = None;
+static int finder_w, finder_h, finder_high;
+
+static void finder_draw(void);
+
+/* Letters get a bit each; digits and everything else share the rest */
+static unsigned long
+finder_charbit(int ch)
+{
+	if (ch >= 'a' && ch <= 'z')
+		return 1UL << (ch - 'a');
+	if (ch >= '0' && ch <= '9')
+		return 1UL << (26 + (ch - '0') % 4);
+	return 1UL << (30 + (ch & 1));
+}
+
+static int
+finder_field(char *p, const char *s)
+{
+	int n;
+
+	if (s == 0 || *s == '\0')
+		return 0;
+	for (n = 0; s[n]; n++)
+		if (p)
+			p[n] = tolower((unsigned char) s[n]);
+	if (p)
+		p[n] = '\n';
+	return n + 1;
+}
+
+static void
+finder_index(FinderEntry *e)
+{
+	Client *c;
+	char *p;
+	int n;
+
+	c = e->c;
+	n = finder_field(0, c->label) + finder_field(0, c->name) +
+	    finder_field(0, c->class) + finder_field(0, c->instance);
+	p = (char *) realloc(e->text, n + 1);
+	if (p == 0) {
+		fprintf(stderr, "9wm: finder: out of memory\n");
+		e->text[0] = '\0';
+		e->mask = 0;
+		return;
+	}
+	e->text = p;
+	p += finder_field(p, c->label);
+	p += finder_field(p, c->name);
+	p += finder_field(p, c->class);
+	p += finder_field(p, c->instance);
+	*p = '\0';
+
+	e->mask = 0;
+	for (p = e->text; *p; p++)
+		if (*p != '\n')
+			e->mask |= finder_charbit(*p);
+}
+
+void
+finder_update(Client *c)
+{
+	FinderEntry *e, **grown;
+
+	if (c == 0)
+		return;
+	if ((e = c->finder_entry) == 0) {
+		if (nentries == maxentries) {
+			grown = (FinderEntry **) realloc(entries, (maxentries * 2 + 16) * sizeof(FinderEntry *));
+			if (grown == 0)
+				return;
+			entries = grown;
+			grown = (FinderEntry **) realloc(match, (maxentries * 2 + 16) * sizeof(FinderEntry *));
+			if (grown == 0)
+				return;
+			match = grown;
+			maxentries = maxentries * 2 + 16;
+		}
+		e = (FinderEntry *) malloc(sizeof(FinderEntry));
+		if (e == 0)
+			return;
+		e->c = c;
+		e->text = (char *) malloc(1);
+		if (e->text == 0) {
+			free(e);
+			return;
+		}
+		e->pos = nentries;
+		entries[nentries++] = e;
+		c->finder_entry = e;
+	}
+	finder_index(e);
+}
+
+/*
+ * The finder's loop still dispatches other events, so a client can go
+ * while it is open: drop it from the matches too, and show what is left.
+ */
+void
+finder_remove(Client *c)
+{
+	FinderEntry *e;
+	int i;
+
+	if (c == 0 || (e = c->finder_entry) == 0)
+		return;
+	for (i = 0; i < nmatch; i++)
+		if (match[i] == e) {
+			memmove(&match[i], &match[i + 1], (nmatch - i - 1) * sizeof(FinderEntry *));
+			nmatch--;
+			if (sel > i || sel >= nmatch)
+				sel--;
+			if (sel < 0)
+				sel = 0;
+			if (first > sel)
+				first = sel;
+			break;
+		}
+	entries[e->pos] = entries[--nentries];
+	entries[e->pos]->pos = e->pos;
+	free(e->text);
+	free(e);
+	c->finder_entry = 0;
+	if (finder_open)
+		finder_draw();
+}
+
+static int
+finder_score(FinderEntry *e)
+{
+	char *line, *end, *p;
+	const char *q;
+	int best;
+
+	if ((e->mask & qmask) != qmask)
+		return 0;
+	if (qlen == 0)
+		return 1;
+	best = strstr(e->text, query) ? 2 : 0;
+	for (line = e->text; *line; line = end + 1) {
+		end = strchr(line, '\n');
+		if (strncmp(line, query, qlen) == 0)
+			return 3;
+		if (best == 0) {
+			for (p = line, q = query; p < end && *q; p++)
+				if (*p == *q)
+					q++;
+			if (*q == '\0')
+				best = 1;
+		}
+	}
+	return best;
+}
+
+static int
+finder_cmp(const void *a, const void *b)
+{
+	const FinderEntry *x = *(const FinderEntry **) a;
+	const FinderEntry *y = *(const FinderEntry **) b;
+
+	if (x->score != y->score)
+		return y->score - x->score;
+	return x->pos - y->pos;
+}
+
+/*
+ * Match the query against the index.  When it only grew, whatever did
+ * not match before cannot match now, so only the last matches are tried.
+ */
+static void
+finder_filter(int narrow)
+{
+	FinderEntry **from, *e;
+	int i, n, count;
+
+	from = narrow ? match : entries;
+	count = narrow ? nmatch : nentries;
+	for (i = n = 0; i < count; i++) {
+		e = from[i];
+		if (withdrawn(e->c))
+			continue;
+		if ((e->score = finder_score(e)) > 0)
+			match[n++] = e;
+	}
+	nmatch = n;
+	qsort(match, nmatch, sizeof(FinderEntry *), finder_cmp);
+	sel = first = 0;
+}
+
+static void
+finder_draw(void)
+{
+	ScreenInfo *s;
+	Client *c;
+	char line[FINDER_QUERY_MAX + 8], where[48];
+	int i, row, y;
+
+	s = finder_screen;
+	XSetForeground(dpy, s->copy_gc, s->menu_bg);
+	XFillRectangle(dpy, finder_buf, s->copy_gc, 0, 0, finder_w, finder_h);
+
+	sprintf(line, "> %s_", query);
+	text_draw(s, finder_buf, 4, text_ascent() + 1, line, 0);
+
+	if (sel < first)
+		first = sel;
+	if (sel >= first + FINDER_ROWS)
+		first = sel - FINDER_ROWS + 1;
+	for (i = first, row = 1; i < nmatch && row <= FINDER_ROWS; i++, row++) {
+		c = match[i]->c;
+		y = row * finder_high;
+		if (i == sel)
+			XFillRectangle(dpy, finder_buf, s->menu_highlight_gc, 0, y, finder_w, finder_high);
+		text_draw(s, finder_buf, 4, y + text_ascent() + 1, c->label ? c->label : "???", i == sel);
+
+		/* Class and workspace on the right, marked when hidden */
+		sprintf(where, "%.32s %d%s", c->class ? c->class : "", c->workspace + 1,
+		        hidden(c) ? " -" : "");
+		text_draw(s, finder_buf, finder_w - text_width(where) - 4, y + text_ascent() + 1,
+		          where, i == sel);
+	}
+	XCopyArea(dpy, finder_buf, finder_win, s->copy_gc, 0, 0, finder_w, finder_h, 0, 0);
+}
+
+static void
+finder_setup(ScreenInfo *s)
+{
+	XSetWindowAttributes attr;
+	Monitor *m;
+	int w, h;
+
+	/* On the head with the pointer */
+	m = monitor_pointer(s);
+	finder_high = text_height();
+	w = m->width / 3;
+	if (w < 320)
+		w = 320;
+	h = (FINDER_ROWS + 1) * finder_high;
+	if (finder_win != None && finder_screen == s && w == finder_w && h == finder_h) {
+		XMoveWindow(dpy, finder_win, m->x + (m->width - w) / 2, m->y + m->height / 4);
+		return;
+	}
+	if (finder_win != None) {
+		XFreePixmap(dpy, finder_buf);
+		XDestroyWindow(dpy, finder_win);
+	}
+	finder_screen = s;
+	finder_w = w;
+	finder_h = h;
+
+	attr.override_redirect = True;
+	attr.background_pixmap = None;       /* Contents always come from the buffer */
+	attr.border_pixel = s->menu_fg;
+	attr.event_mask = ExposureMask | ButtonPressMask | KeyPressMask;
+	finder_win = XCreateWindow(dpy, s->root, m->x + (m->width - w) / 2,
+	                           m->y + m->height / 4, w, h, MENUBORDER,
+	                           CopyFromParent, InputOutput, CopyFromParent,
+	                           CWOverrideRedirect | CWBackPixmap | CWBorderPixel | CWEventMask,
+	                           &attr);
+	finder_buf = XCreatePixmap(dpy, finder_win, w, h, DefaultDepth(dpy, s->num));
+}
+
+/* Colours or font changed: the window is made again when next shown */
+void
+finder_reset(void)
+{
+	if (finder_win == None)
+		return;
+	XFreePixmap(dpy, finder_buf);
+	XDestroyWindow(dpy, finder_win);
+	finder_win = None;
+	finder_buf = None;
+}
+
+/* Bring c into view: its workspace, out of hiding, on top and focused */
+static void
+finder_select(Client *c)
+{
+	if (c->workspace >= 0 && !workspace_shown(c))
+		workspace_show_on(monitor_of(c), c->workspace);
+	if (hidden(c)) {
+		unhidec(c, 1);
+	} else {
+		XMapRaised(dpy, c->parent);
+		top(c);
+		active(c);
+	}
+}
+
+void
+finder_show(ScreenInfo *s)
+{
+	XEvent ev;
+	KeySym ks;
+	Client *chosen;
+	char buf[8];
+	int n, row;
+
+	if (s == 0)
+		return;
+	finder_setup(s);
+	qlen = 0;
+	query[0] = '\0';
+	qmask = 0;
+	finder_filter(0);
+	finder_draw();
+
+	XMapRaised(dpy, finder_win);
+	if (XGrabKeyboard(dpy, finder_win, True, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess) {
+		XUnmapWindow(dpy, finder_win);
+		return;
+	}
+
+	modal_begin(0);
+	modal_keys(finder_win);
+	finder_open = 1;
+	chosen = 0;
+	for (;;) {
+		waitevent(finder_win, &ev, ExposureMask | ButtonPressMask | KeyPressMask, -1L);
+		if (ev.type == Expose) {
+			if (ev.xexpose.count == 0)
+				XCopyArea(dpy, finder_buf, finder_win, s->copy_gc, 0, 0, finder_w, finder_h, 0, 0);
+			continue;
+		}
+		if (ev.type == ButtonPress) {
+			row = ev.xbutton.y / finder_high - 1;
+			if (row >= 0 && row < FINDER_ROWS && first + row < nmatch)
+				chosen = match[first + row]->c;
+			break;
+		}
+
+		n = XLookupString(&ev.xkey, buf, sizeof(buf), &ks, 0);
+		if (ks == XK_Escape)
+			break;
+		if (ks == XK_Return || ks == XK_KP_Enter) {
+			if (nmatch > 0)
+				chosen = match[sel]->c;
+			break;
+		}
+		if (ks == XK_Up || (ks == XK_p && (ev.xkey.state & ControlMask))) {
+			if (sel > 0)
+				sel--;
+		} else if (ks == XK_Down || ks == XK_Tab || (ks == XK_n && (ev.xkey.state & ControlMask))) {
+			if (sel < nmatch - 1)
+				sel++;
+		} else if (ks == XK_BackSpace) {
+			if (qlen == 0)
+				continue;
+			query[--qlen] = '\0';
+			for (qmask = 0, n = 0; n < qlen; n++)
+				qmask |= finder_charbit(query[n]);
+			finder_filter(0);
+		} else if (ks == XK_u && (ev.xkey.state & ControlMask)) {
+			qlen = 0;
+			query[0] = '\0';
+			qmask = 0;
+			finder_filter(0);
+		} else if (n == 1 && isprint((unsigned char) buf[0]) && qlen < FINDER_QUERY_MAX - 1) {
+			query[qlen++] = tolower((unsigned char) buf[0]);
+			query[qlen] = '\0';
+			qmask |= finder_charbit(query[qlen - 1]);
+			finder_filter(1);
+		} else {
+			continue;
+		}
+		finder_draw();
+	}
+
+	finder_open = 0;
+	XUngrabKeyboard(dpy, CurrentTime);
+	XUnmapWindow(dpy, finder_win);
+	modal_end();
+	if (chosen)
+		finder_select(chosen);
+}
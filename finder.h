@@ -0,0 +1,30 @@
+/*
+ * Window finder for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ */
+
+#ifndef FINDER_H
+#define FINDER_H
+
+#include <X11/Xlib.h>
+
+#define FINDER_ROWS 12
+#define FINDER_QUERY_MAX 64
+
+typedef struct FinderEntry FinderEntry;
+
+struct FinderEntry {
+	Client *c;
+	int pos;                /* Slot in the index */
+	unsigned long mask;     /* Characters present in text, for quick rejection */
+	char *text;             /* Lowercased label, name, class and instance, one per line */
+	int score;              /* Of the last query it was matched against */
+};
+
+/* Function prototypes */
+void finder_update(Client *c);
+void finder_remove(Client *c);
+void finder_show(ScreenInfo *s);
+void finder_reset(void);
+
+#endif /* FINDER_H */
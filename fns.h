@@ -17,10 +17,15 @@ void	sendcmessage();
 void	sendconfig();
 void	sighandler();
 void	getevent();
+long	mstime();
 void	cleanup();
+void	setcolors();
+void	grabkeys();
+void	reconfigure();
 
 /* event.c */
 void	mainloop();
+void	dispatch();
 void	configurereq();
 void	mapreq();
 void	circulatereq();
@@ -75,7 +80,6 @@ void	hide_submenu_for(ScreenInfo *s);
 const char* get_submenu_command(int menu_idx, int sub_idx);
 void	build_submenu_for_rendering(int menu_idx);
 char**	get_submenu_items();
-void	tile_windows();
 
 /* client.c */
 void	setactive();
@@ -98,6 +102,20 @@ int	get_text_width();
 int	get_font_ascent();
 int	get_font_descent();
 #endif
+int	text_width();
+void	text_cache_flush();
+int	text_ascent();
+int	text_height();
+void	text_draw();
+MenuStrip	*menu_strip();
+void	menu_strip_row();
+void	modal_begin();
+void	modal_keepclients();
+void	modal_keys();
+void	modal_end();
+int	modalevent();
+int	waitevent();
+void	motion_compress();
 Client	*selectwin();
 int 	sweep();
 int 	sweep_area();
@@ -105,6 +123,15 @@ int 	drag();
 void	getmouse();
 void	setmouse();
 
+/* opaque.c */
+int	opaque_init();
+void	opaque_apply();
+void	opaque_begin();
+void	opaque_moveresize();
+void	opaque_wait();
+void	opaque_end();
+void	opaque_getcounter();
+
 /* error.c */
 int 	handler();
 void	fatal();
@@ -144,9 +171,33 @@ void	spaces_init();
 void	spaces_show();
 void	spaces_hide();
 void	spaces_draw();
+void	spaces_draw_cells();
+void	spaces_expose();
+void	spaces_prerender();
+void	spaces_reset();
+void	spaces_scroll();
 void	spaces_handle_button();
 void	spaces_handle_motion();
 void	spaces_handle_key();
 int	spaces_get_workspace_at_point();
 void	spaces_draw_workspace();
 void	spaces_draw_window_thumbnail();
+void	spaces_damage();
+void	spaces_refresh();
+int	spaces_refresh_timeout();
+
+/* finder.c */
+void	finder_update();
+void	finder_remove();
+void	finder_show();
+
+/* thumb.c */
+int	thumb_init();
+void	thumb_track();
+void	thumb_untrack();
+void	thumb_free();
+int	thumb_capture();
+void	thumb_capture_end();
+Client*	thumb_handle_damage();
+int	thumb_draw();
+void	thumb_cache_stats();
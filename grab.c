@@ -2,6 +2,8 @@
  * Copyright multiple authors, see README for licence details
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <ctype.h>
 #include <X11/X.h>
 #include <X11/Xos.h>
@@ -11,6 +13,7 @@
 #include "dat.h"
 #include "fns.h"
 #include "config.h"
+#include "monitor.h"
 
 static char* prepare_menu_text(const char* original, char* buffer, int buffer_size);
 
@@ -18,7 +21,7 @@ static char* prepare_menu_text(const char* original, char* buffer, int buffer_si
 int get_text_width(const char* text);
 int get_font_ascent(void);
 int get_font_descent(void);
-static void draw_text(ScreenInfo *s, Window win, int x, int y, const char* text, int highlight);
+static void draw_text(ScreenInfo *s, Drawable win, int x, int y, const char* text, int highlight);
 #endif
 
 static char*
@@ -56,7 +59,100 @@ get_text_width(const char* text)
 	}
 	return 0;
 }
+#endif
+
+/*
+ * Widths of strings already measured in the current font.  Menus and
+ * titlebars draw the same few strings over and over, so a small hash
+ * table saves a round of glyph lookups each time.  Everything is
+ * dropped when the font changes or the table fills up.
+ */
+#define TEXT_CACHE_SIZE	256
+#define TEXT_CACHE_MAX	1024
+
+typedef struct TextExtent TextExtent;
+struct TextExtent {
+	TextExtent	*next;
+	unsigned long	hash;
+	int		width;
+	char		str[1];
+};
+
+static TextExtent *text_cache[TEXT_CACHE_SIZE];
+static int text_cache_count;
+static void *text_cache_font;
+
+void
+text_cache_flush(void)
+{
+	TextExtent *t, *next;
+	int i;
+
+	for (i = 0; i < TEXT_CACHE_SIZE; i++) {
+		for (t = text_cache[i]; t; t = next) {
+			next = t->next;
+			free(t);
+		}
+		text_cache[i] = 0;
+	}
+	text_cache_count = 0;
+	text_cache_font = 0;
+}
+
+int
+text_width(const char *text)
+{
+	TextExtent *t;
+	unsigned long h;
+	const char *p;
+	void *f;
+	int len;
+
+#ifdef XFT
+	f = use_xft && xft_font ? (void *) xft_font : (void *) font;
+#else
+	f = (void *) font;
+#endif
+	if (f == 0)
+		return 0;
+	if (f != text_cache_font) {
+		text_cache_flush();
+		text_cache_font = f;
+	}
+
+	for (h = 0, p = text; *p; p++)
+		h = h * 31 + (unsigned char) *p;
+	len = p - text;
+	for (t = text_cache[h % TEXT_CACHE_SIZE]; t; t = t->next)
+		if (t->hash == h && strcmp(t->str, text) == 0)
+			return t->width;
+
+	if (text_cache_count >= TEXT_CACHE_MAX) {
+		text_cache_flush();
+		text_cache_font = f;
+	}
+	t = (TextExtent *) malloc(sizeof(TextExtent) + len);
+	if (t == 0) {
+#ifdef XFT
+		return get_text_width(text);
+#else
+		return XTextWidth(font, text, len);
+#endif
+	}
+	memcpy(t->str, text, len + 1);
+	t->hash = h;
+#ifdef XFT
+	t->width = get_text_width(text);
+#else
+	t->width = XTextWidth(font, text, len);
+#endif
+	t->next = text_cache[h % TEXT_CACHE_SIZE];
+	text_cache[h % TEXT_CACHE_SIZE] = t;
+	text_cache_count++;
+	return t->width;
+}
 
+#ifdef XFT
 int
 get_font_ascent(void)
 {
@@ -80,7 +176,7 @@ get_font_descent(void)
 }
 
 static void
-draw_text(ScreenInfo *s, Window win, int x, int y, const char* text, int highlight)
+draw_text(ScreenInfo *s, Drawable win, int x, int y, const char* text, int highlight)
 {
 	if (use_xft && xft_font && s->xft_draw) {
 		/* Update XftDraw drawable to current window */
@@ -97,6 +193,167 @@ draw_text(ScreenInfo *s, Window win, int x, int y, const char* text, int highlig
 }
 #endif
 
+/* Font metrics and text drawing in the menu colours, whichever font is loaded */
+int
+text_ascent(void)
+{
+#ifdef XFT
+	return get_font_ascent();
+#else
+	return font ? font->ascent : 0;
+#endif
+}
+
+int
+text_height(void)
+{
+#ifdef XFT
+	return get_font_ascent() + get_font_descent() + 1;
+#else
+	return font ? font->ascent + font->descent + 1 : 0;
+#endif
+}
+
+void
+text_draw(ScreenInfo *s, Drawable d, int x, int y, const char *text, int highlight)
+{
+#ifdef XFT
+	draw_text(s, d, x, y, text, highlight);
+#else
+	if (font)
+		XDrawString(dpy, d, highlight ? s->menu_highlight_text_gc : s->text_gc,
+		            x, y, text, strlen(text));
+#endif
+}
+
+/* Hash of a menu's items, to reject most changes without comparing them */
+static unsigned long
+menu_sig(char **items)
+{
+	unsigned long h;
+	char *p;
+	int i;
+
+	h = 0;
+	for (i = 0; items[i]; i++) {
+		for (p = items[i]; *p; p++)
+			h = h * 31 + (unsigned char) *p;
+		h = h * 31 + 1;
+	}
+	return h;
+}
+
+/* Whether ms was drawn from exactly these items */
+static int
+menu_same(MenuStrip *ms, char **items)
+{
+	char *t;
+	int i;
+
+	if (ms->text == 0)
+		return 0;
+	t = ms->text;
+	for (i = 0; items[i]; i++) {
+		if (i >= ms->n || strcmp(t, items[i]) != 0)
+			return 0;
+		t += strlen(t) + 1;
+	}
+	return i == ms->n;
+}
+
+/*
+ * Make sure ms holds items rendered into two pixmaps, one normal and
+ * one all highlighted, so that drawing a row is a single XCopyArea.
+ * Nothing is measured or drawn unless the items changed.
+ */
+MenuStrip *
+menu_strip(ScreenInfo *s, MenuStrip *ms, char **items)
+{
+	char text_buffer[256];
+	char *display_text, *t;
+	unsigned long sig;
+	int i, n, len, wide, high, tx, ty;
+
+	high = text_height();
+	sig = menu_sig(items);
+	if (ms->normal != None && ms->sig == sig && ms->high == high &&
+	    ms->lower == (config.lower != 0) && menu_same(ms, items))
+		return ms;
+
+	wide = 0;
+	len = 0;
+	for (n = 0; items[n]; n++) {
+		i = text_width(items[n]) + 4;
+		if (i > wide)
+			wide = i;
+		len += strlen(items[n]) + 1;
+	}
+	if (ms->normal != None) {
+		XFreePixmap(dpy, ms->normal);
+		XFreePixmap(dpy, ms->highlight);
+		ms->normal = ms->highlight = None;
+	}
+	/* Keep the items themselves; a hash alone can collide */
+	free(ms->text);
+	if ((ms->text = (char *) malloc(len + 1)) != 0)
+		for (t = ms->text, i = 0; i < n; i++) {
+			strcpy(t, items[i]);
+			t += strlen(t) + 1;
+		}
+	ms->n = n;
+	ms->wide = wide;
+	ms->high = high;
+	ms->lower = config.lower != 0;
+	ms->sig = sig;
+	if (n == 0 || wide == 0)
+		return ms;
+
+	ms->normal = XCreatePixmap(dpy, s->root, wide, n * high, DefaultDepth(dpy, s->num));
+	ms->highlight = XCreatePixmap(dpy, s->root, wide, n * high, DefaultDepth(dpy, s->num));
+	XSetForeground(dpy, s->copy_gc, s->menu_bg);
+	XFillRectangle(dpy, ms->normal, s->copy_gc, 0, 0, wide, n * high);
+	XFillRectangle(dpy, ms->highlight, s->menu_highlight_gc, 0, 0, wide, n * high);
+	for (i = 0; i < n; i++) {
+		/* Prepare text (with optional lowercase) */
+		display_text = prepare_menu_text(items[i], text_buffer, sizeof(text_buffer));
+
+		/* Center all text */
+		tx = (wide - text_width(display_text)) / 2;
+		ty = i * high + text_ascent() + 1;
+		text_draw(s, ms->normal, tx, ty, display_text, 0);
+		text_draw(s, ms->highlight, tx, ty, display_text, 1);
+	}
+	return ms;
+}
+
+/* Copy one row of ms, normal or highlighted, into w */
+void
+menu_strip_row(ScreenInfo *s, MenuStrip *ms, Window w, int row, int highlight)
+{
+	if (ms->normal == None || row < 0 || row >= ms->n)
+		return;
+	XCopyArea(dpy, highlight ? ms->highlight : ms->normal, w, s->copy_gc,
+	          0, row * ms->high, ms->wide, ms->high, 0, row * ms->high);
+}
+
+/*
+ * Replace the MotionNotify in ev by the last of any queued right behind
+ * it for the same window.  Stopping at the first other event means
+ * nothing is reordered, and no position from after a release is used.
+ */
+void
+motion_compress(XEvent * ev)
+{
+	XEvent next;
+
+	while (XEventsQueued(dpy, QueuedAfterReading) > 0) {
+		XPeekEvent(dpy, &next);
+		if (next.type != MotionNotify || next.xmotion.window != ev->xmotion.window)
+			break;
+		XNextEvent(dpy, ev);
+	}
+}
+
 int
 nobuttons(XButtonEvent * e)
 {
@@ -106,6 +363,10 @@ nobuttons(XButtonEvent * e)
 	return (e->type == ButtonRelease) && (state & (state - 1)) == 0;
 }
 
+/* Where the modal loop's own input goes, see modal_holds() */
+static Window modal_pointer = None;
+static Window modal_keyboard = None;
+
 int
 grab(Window w, Window constrain, int mask, Cursor curs, int t)
 {
@@ -114,6 +375,8 @@ grab(Window w, Window constrain, int mask, Cursor curs, int t)
 	if (t == 0)
 		t = timestamp();
 	status = XGrabPointer(dpy, w, False, mask, GrabModeAsync, GrabModeAsync, constrain, curs, t);
+	if (status == GrabSuccess)
+		modal_pointer = w;
 	return status;
 }
 
@@ -122,30 +385,57 @@ ungrab(XButtonEvent * e)
 {
 	XEvent ev;
 
-	if (!nobuttons(e))
+	/* Other clients are still serviced while the last buttons come up */
+	if (!nobuttons(e)) {
+		modal_begin(0);
 		for (;;) {
-			XMaskEvent(dpy, ButtonMask | ButtonMotionMask, &ev);
+			waitevent(None, &ev, ButtonMask | ButtonMotionMask, -1L);
 			if (ev.type == MotionNotify)
 				continue;
 			e = &ev.xbutton;
 			if (nobuttons(e))
 				break;
 		}
+		modal_end();
+	}
 	XUngrabPointer(dpy, e->time);
 	curtime = e->time;
 }
 
+/* Whether root position x, y falls on the submenu, border included */
+static int
+submenu_hit(ScreenInfo *s, int x, int y)
+{
+	return x >= s->submenu_x && x < s->submenu_x + (int)s->submenu_w + 2 * MENUBORDER &&
+	       y >= s->submenu_y && y < s->submenu_y + (int)s->submenu_h + 2 * MENUBORDER;
+}
+
+/* Move the submenu highlight from *cur to row, straight from its strip */
+static void
+submenu_select(ScreenInfo *s, int *cur, int row, int count)
+{
+	if (row < 0 || row >= count)
+		row = -1;
+	if (row == *cur)
+		return;
+	menu_strip_row(s, &s->substrip, s->submenuwin, *cur, 0);
+	menu_strip_row(s, &s->substrip, s->submenuwin, row, 1);
+	*cur = row;
+}
+
 int
 menuhit(XButtonEvent * e, Menu * m)
 {
 	XEvent ev;
 	int i, n, cur, old, wide, high, status, drawn, warp;
-	int x, y, dx, dy, xmax, ymax;
-	int tx, ty;
+	int x, y, dx, dy, xmin, ymin, xmax, ymax;
+	int px, py;		/* Last known pointer position, root relative */
 	int submenu_active = -1, in_submenu = 0, submenu_cur = -1;
-	Time submenu_hide_time = 0;  /* When to hide submenu (0 = don't hide) */
+	long submenu_hide_time = 0;  /* When to hide submenu, by mstime() (0 = don't hide) */
 	const int SUBMENU_DELAY_MS = 60;  /* 250ms delay before hiding */
 	ScreenInfo *s;
+	MenuStrip *ms;
+	Monitor *mon;
 
 #ifdef XFT
 	if (!use_xft && font == 0) {
@@ -166,35 +456,27 @@ menuhit(XButtonEvent * e, Menu * m)
 	if (s == 0 || e->window == s->menuwin)	/* ugly event mangling */
 		return -1;
 
-	dx = 0;
-	for (n = 0; m->item[n]; n++) {
-#ifdef XFT
-		wide = get_text_width(m->item[n]) + 4;
-#else
-		wide = XTextWidth(font, m->item[n], strlen(m->item[n])) + 4;
-#endif
-		if (wide > dx)
-			dx = wide;
-	}
-	wide = dx;
+	ms = menu_strip(s, &s->menustrip, m->item);
+	n = ms->n;
+	dx = wide = ms->wide;
+	high = ms->high;
 	cur = m->lasthit;
 	if (cur >= n)
 		cur = n - 1;
 
-#ifdef XFT
-	high = get_font_ascent() + get_font_descent() + 1;
-#else
-	high = font->ascent + font->descent + 1;
-#endif
 	dy = n * high;
 	x = e->x - wide / 2;
 	y = e->y - cur * high - high / 2;
 	warp = 0;
-	xmax = DisplayWidth(dpy, s->num);
-	ymax = DisplayHeight(dpy, s->num);
-	if (x < 0) {
-		e->x -= x;
-		x = 0;
+	/* Keep to the head that was clicked on */
+	mon = monitor_at(s, e->x, e->y);
+	xmin = mon->x;
+	ymin = mon->y;
+	xmax = mon->x + mon->width;
+	ymax = mon->y + mon->height;
+	if (x < xmin) {
+		e->x += xmin - x;
+		x = xmin;
 		warp++;
 	}
 	if (x + wide >= xmax) {
@@ -202,9 +484,9 @@ menuhit(XButtonEvent * e, Menu * m)
 		x = xmax - wide;
 		warp++;
 	}
-	if (y < 0) {
-		e->y -= y;
-		y = 0;
+	if (y < ymin) {
+		e->y += ymin - y;
+		y = ymin;
 		warp++;
 	}
 	if (y + dy >= ymax) {
@@ -215,6 +497,10 @@ menuhit(XButtonEvent * e, Menu * m)
 	if (warp)
 		setmouse(e->x, e->y, s);
 	XMoveResizeWindow(dpy, s->menuwin, x, y, dx, dy);
+	s->menu_x = x;
+	s->menu_y = y;
+	s->menu_w = dx;
+	s->menu_h = dy;
 	XSelectInput(dpy, s->menuwin, MenuMask);
 	
 	
@@ -227,54 +513,32 @@ menuhit(XButtonEvent * e, Menu * m)
 		XUnmapWindow(dpy, s->menuwin);
 		return -1;
 	}
+	modal_begin(0);
+	modal_keepclients();
 	drawn = 0;
+	px = e->x;
+	py = e->y;
 	for (;;) {
-		XMaskEvent(dpy, MenuMask, &ev);
-		
-		/* Check if submenu hide timer has expired */
-		if (submenu_hide_time > 0) {
-			Time current_time = 0;
-			/* Get current time from the event */
-			switch (ev.type) {
-			case ButtonPress:
-			case ButtonRelease:
-				current_time = ev.xbutton.time;
-				break;
-			case MotionNotify:
-				current_time = ev.xmotion.time;
-				break;
-			default:
-				current_time = CurrentTime;
-				break;
-			}
-			
-			if (current_time != CurrentTime && current_time >= submenu_hide_time) {
-				/* Before hiding, check if mouse is actually over submenu */
-				Window root_return, child_return;
-				int root_x, root_y, win_x, win_y;
-				unsigned int mask;
-				
-				if (XQueryPointer(dpy, s->root, &root_return, &child_return,
-				                 &root_x, &root_y, &win_x, &win_y, &mask)) {
-					
-					/* Use stored absolute coordinates for comparison */
-					if (root_x >= s->submenu_x && root_x < s->submenu_x + (int)s->submenu_w &&
-					    root_y >= s->submenu_y && root_y < s->submenu_y + (int)s->submenu_h) {
-						/* Mouse is over submenu - don't hide, reset timer */
-						submenu_hide_time = current_time + SUBMENU_DELAY_MS;
-					} else if (child_return == s->submenuwin) {
-						/* XQueryPointer says mouse is in submenu window */
-						submenu_hide_time = current_time + SUBMENU_DELAY_MS;
-					} else {
-						/* Mouse is not over submenu - hide it */
-						hide_submenu_for(s);
-						submenu_active = -1;
-						in_submenu = 0;
-						submenu_hide_time = 0;
-					}
-				}
+		/* Hide the submenu once its delay runs out, events or not */
+		if (submenu_hide_time > 0 && mstime() >= submenu_hide_time) {
+			/* Before hiding, check if the pointer is over the submenu */
+			if (submenu_hit(s, px, py)) {
+				/* Mouse is over submenu - don't hide, reset timer */
+				submenu_hide_time = mstime() + SUBMENU_DELAY_MS;
+			} else {
+				/* Mouse is not over submenu - hide it */
+				hide_submenu_for(s);
+				submenu_active = -1;
+				in_submenu = 0;
+				submenu_hide_time = 0;
 			}
 		}
+		if (!waitevent(None, &ev, MenuMask, submenu_hide_time > 0 ? submenu_hide_time : -1))
+			continue;
+		if (ev.type == MotionNotify) {
+			px = ev.xmotion.x_root;
+			py = ev.xmotion.y_root;
+		}
 		
 		switch (ev.type) {
 		default:
@@ -304,18 +568,11 @@ menuhit(XButtonEvent * e, Menu * m)
 			    (in_submenu && submenu_cur >= 0))) {
 				/* Click was on submenu - handle submenu selection */
 				int sub_result = -1;
-				int sub_item_height;
-				
-#ifdef XFT
-				sub_item_height = get_font_ascent() + get_font_descent() + 1;
-#else
-				sub_item_height = font->ascent + font->descent + 1;
-#endif
 				
 				/* Calculate which submenu item was clicked */
 				if (ev.xbutton.window == s->submenuwin) {
 					/* Direct click on submenu window */
-					sub_result = ev.xbutton.y / sub_item_height;
+					sub_result = ev.xbutton.y / s->substrip.high;
 				} else {
 					/* Click through main menu while over submenu - use tracked position */
 					sub_result = submenu_cur;
@@ -326,6 +583,7 @@ menuhit(XButtonEvent * e, Menu * m)
 					ungrab(&ev.xbutton);
 					XUnmapWindow(dpy, s->menuwin);
 					hide_submenu_for(s);
+					modal_end();
 					
 					/* Return encoded submenu result: 1000 + (parent_index * 100) + sub_index */
 					return 1000 + (submenu_active * 100) + sub_result;
@@ -338,6 +596,7 @@ menuhit(XButtonEvent * e, Menu * m)
 			ungrab(&ev.xbutton);
 			XUnmapWindow(dpy, s->menuwin);
 			hide_submenu_for(s);
+			modal_end();
 			return i;
 		case MotionNotify:
 			if (!drawn)
@@ -350,24 +609,9 @@ menuhit(XButtonEvent * e, Menu * m)
 				cur = submenu_active;
 				in_submenu = 1;
 				
-				/* Calculate which submenu item is hovered for future highlighting */
-				int sub_item_height;
-#ifdef XFT
-				sub_item_height = get_font_ascent() + get_font_descent() + 1;
-#else
-				sub_item_height = font->ascent + font->descent + 1;
-#endif
-				int new_submenu_cur = ev.xmotion.y / sub_item_height;
-				if (new_submenu_cur < 0 || new_submenu_cur >= config.menu_items[submenu_active].submenu_count) {
-					new_submenu_cur = -1;
-				}
-				
-				/* Trigger redraw if submenu selection changed */
-				if (new_submenu_cur != submenu_cur) {
-					submenu_cur = new_submenu_cur;
-					/* Trigger expose event to redraw submenu with new highlighting */
-					XClearArea(dpy, s->submenuwin, 0, 0, 0, 0, True);
-				}
+				/* Highlight the hovered submenu item */
+				submenu_select(s, &submenu_cur, ev.xmotion.y / s->substrip.high,
+				               config.menu_items[submenu_active].submenu_count);
 				
 				old = cur; /* Prevent unnecessary updates */
 				break;
@@ -386,38 +630,16 @@ menuhit(XButtonEvent * e, Menu * m)
 			if (x < 0 || x > wide || y < -3) {
 				/* If outside main menu, check if we're over the submenu */
 				if (submenu_active >= 0) {
-					/* Convert mouse coordinates to root coordinates */
-					Window child;
-					int root_x, root_y;
-					XTranslateCoordinates(dpy, s->menuwin, s->root, x, y, &root_x, &root_y, &child);
-					
 					/* Check if mouse is over submenu using stored coordinates */
-					if (root_x >= s->submenu_x && root_x < s->submenu_x + (int)s->submenu_w &&
-					    root_y >= s->submenu_y && root_y < s->submenu_y + (int)s->submenu_h) {
+					if (submenu_hit(s, px, py)) {
 						/* Mouse is over submenu - keep current state and cancel hide timer */
 						cur = submenu_active;
 						in_submenu = 1;
 						submenu_hide_time = 0;  /* Cancel hide timer */
 						
-						/* Calculate which submenu item is hovered */
-						int sub_item_height;
-#ifdef XFT
-						sub_item_height = get_font_ascent() + get_font_descent() + 1;
-#else
-						sub_item_height = font->ascent + font->descent + 1;
-#endif
-						/* Calculate submenu item based on position relative to submenu window */
-						int new_submenu_cur = (root_y - s->submenu_y) / sub_item_height;
-						if (new_submenu_cur < 0 || new_submenu_cur >= config.menu_items[submenu_active].submenu_count) {
-							new_submenu_cur = -1;
-						}
-						
-						/* Trigger redraw if submenu selection changed */
-						if (new_submenu_cur != submenu_cur) {
-							submenu_cur = new_submenu_cur;
-							/* Trigger expose event to redraw submenu with new highlighting */
-							XClearArea(dpy, s->submenuwin, 0, 0, 0, 0, True);
-						}
+						/* Highlight the submenu item under the pointer */
+						submenu_select(s, &submenu_cur, (py - s->submenu_y - MENUBORDER) / s->substrip.high,
+						               config.menu_items[submenu_active].submenu_count);
 					} else {
 						/* Mouse is outside both menus */
 						cur = -1;
@@ -435,7 +657,7 @@ menuhit(XButtonEvent * e, Menu * m)
 				if (submenu_active != cur && !in_submenu) {
 					if (submenu_active >= 0) {
 						/* Start hide timer instead of immediately hiding */
-						submenu_hide_time = ev.xmotion.time + SUBMENU_DELAY_MS;
+						submenu_hide_time = mstime() + SUBMENU_DELAY_MS;
 					}
 				} else if (submenu_active == cur) {
 					/* Mouse returned to folder item - cancel hide timer */
@@ -445,188 +667,44 @@ menuhit(XButtonEvent * e, Menu * m)
 				/* Show submenu for folder items */
 				if (cur >= 0 && cur < config.menu_count && 
 				    config.menu_items[cur].is_folder) {
-					/* Get actual menu window position */
-					Window root_return;
-					int menu_x, menu_y;
-					unsigned int menu_width, menu_height, border_width, depth;
-					
-					XGetGeometry(dpy, s->menuwin, &root_return, &menu_x, &menu_y, 
-					            &menu_width, &menu_height, &border_width, &depth);
-					
-					
-					show_submenu_at(e, cur, s, menu_x, menu_y, menu_width, high);
+					show_submenu_at(e, cur, s, s->menu_x, s->menu_y, s->menu_w, high);
+					if (submenu_active != cur)
+						submenu_cur = -1;
 					submenu_active = cur;
 				}
 			}
 			
 			if (cur == old)
 				break;
-			if (old >= 0 && old < n) {
-				/* Redraw old item normally */
-				char *item = m->item[old];
-				char text_buffer[256];
-				char *display_text;
-				int tx, ty;
-				
-				/* Clear the area completely first */
-				XClearArea(dpy, s->menuwin, 0, old * high, wide, high, False);
-				
-				/* Prepare text (with optional lowercase) */
-				display_text = prepare_menu_text(item, text_buffer, sizeof(text_buffer));
-				
-				/* Center all text */
-#ifdef XFT
-				tx = (wide - get_text_width(display_text)) / 2;
-				ty = old * high + get_font_ascent() + 1;
-				draw_text(s, s->menuwin, tx, ty, display_text, 0);
-#else
-				tx = (wide - XTextWidth(font, display_text, strlen(display_text))) / 2;
-				ty = old * high + font->ascent + 1;
-				XDrawString(dpy, s->menuwin, s->text_gc, tx, ty, display_text, strlen(display_text));
-#endif
-			}
-			if (cur >= 0 && cur < n) {
-				/* Draw current item highlighted */
-				char *item = m->item[cur];
-				char text_buffer[256];
-				char *display_text;
-				int tx, ty;
-				
-				/* Fill with blue background */
-				XFillRectangle(dpy, s->menuwin, s->menu_highlight_gc, 0, cur * high, wide, high);
-				
-				/* Prepare text (with optional lowercase) */
-				display_text = prepare_menu_text(item, text_buffer, sizeof(text_buffer));
-				
-				/* Center all text */
-#ifdef XFT
-				tx = (wide - get_text_width(display_text)) / 2;
-				ty = cur * high + get_font_ascent() + 1;
-				draw_text(s, s->menuwin, tx, ty, display_text, 1);
-#else
-				tx = (wide - XTextWidth(font, display_text, strlen(display_text))) / 2;
-				ty = cur * high + font->ascent + 1;
-				XDrawString(dpy, s->menuwin, s->menu_highlight_text_gc, tx, ty, display_text, strlen(display_text));
-#endif
-			}
+			/* Both rows come straight from the pre-rendered strip */
+			menu_strip_row(s, ms, s->menuwin, old, 0);
+			menu_strip_row(s, ms, s->menuwin, cur, 1);
 			break;
 		case Expose:
+			if (ev.xexpose.window != s->menuwin && ev.xexpose.window != s->submenuwin) {
+				/* A titlebar or such, not ours */
+				dispatch(&ev);
+				break;
+			}
 			if (ev.xexpose.window == s->submenuwin && submenu_active >= 0) {
 				/* Handle submenu expose */
-				int sub_n, sub_wide, sub_high, sub_i, sub_tx, sub_ty;
-				char **sub_items;
+				MenuStrip *sub;
 				
 				/* Build submenu if needed */
 				build_submenu_for_rendering(submenu_active);
-				sub_items = get_submenu_items();
-				
-				/* Calculate submenu dimensions */
-				sub_wide = 0;
-				for (sub_n = 0; sub_items[sub_n]; sub_n++) {
-#ifdef XFT
-					int item_width = get_text_width(sub_items[sub_n]) + 4;
-#else
-					int item_width = XTextWidth(font, sub_items[sub_n], strlen(sub_items[sub_n])) + 4;
-#endif
-					if (item_width > sub_wide)
-						sub_wide = item_width;
-				}
-				
-#ifdef XFT
-				sub_high = get_font_ascent() + get_font_descent() + 1;
-#else
-				sub_high = font->ascent + font->descent + 1;
-#endif
+				sub = menu_strip(s, &s->substrip, get_submenu_items());
 				
-				XClearWindow(dpy, s->submenuwin);
-				for (sub_i = 0; sub_i < sub_n; sub_i++) {
-					char *sub_item = sub_items[sub_i];
-					char sub_text_buffer[256];
-					char *sub_display_text;
-					
-					/* Prepare text (with optional lowercase) */
-					sub_display_text = prepare_menu_text(sub_item, sub_text_buffer, sizeof(sub_text_buffer));
-					
-					/* Center all text */
-#ifdef XFT
-					sub_tx = (sub_wide - get_text_width(sub_display_text)) / 2;
-					sub_ty = sub_i * sub_high + get_font_ascent() + 1;
-					draw_text(s, s->submenuwin, sub_tx, sub_ty, sub_display_text, 0);
-#else
-					sub_tx = (sub_wide - XTextWidth(font, sub_display_text, strlen(sub_display_text))) / 2;
-					sub_ty = sub_i * sub_high + font->ascent + 1;
-					XDrawString(dpy, s->submenuwin, s->text_gc, sub_tx, sub_ty, sub_display_text, strlen(sub_display_text));
-#endif
-				}
+				XCopyArea(dpy, sub->normal, s->submenuwin, s->copy_gc, 0, 0,
+				          sub->wide, sub->n * sub->high, 0, 0);
 				
 				/* Draw highlighted submenu item if any */
-				if (submenu_cur >= 0 && submenu_cur < sub_n) {
-					char *sub_item = sub_items[submenu_cur];
-					char sub_text_buffer[256];
-					char *sub_display_text;
-					
-					/* Fill with blue background */
-					XFillRectangle(dpy, s->submenuwin, s->menu_highlight_gc, 0, submenu_cur * sub_high, sub_wide, sub_high);
-					
-					/* Prepare text (with optional lowercase) */
-					sub_display_text = prepare_menu_text(sub_item, sub_text_buffer, sizeof(sub_text_buffer));
-					
-					/* Center highlighted text */
-#ifdef XFT
-					sub_tx = (sub_wide - get_text_width(sub_display_text)) / 2;
-					sub_ty = submenu_cur * sub_high + get_font_ascent() + 1;
-					draw_text(s, s->submenuwin, sub_tx, sub_ty, sub_display_text, 1);
-#else
-					sub_tx = (sub_wide - XTextWidth(font, sub_display_text, strlen(sub_display_text))) / 2;
-					sub_ty = submenu_cur * sub_high + font->ascent + 1;
-					XDrawString(dpy, s->submenuwin, s->menu_highlight_text_gc, sub_tx, sub_ty, sub_display_text, strlen(sub_display_text));
-#endif
-				}
-			} else {
+				menu_strip_row(s, sub, s->submenuwin, submenu_cur, 1);
+			} else if (ms->normal != None) {
 				/* Handle main menu expose */
-				XClearWindow(dpy, s->menuwin);
-			for (i = 0; i < n; i++) {
-				char *item = m->item[i];
-				char text_buffer[256];
-				char *display_text;
-				
-				/* Prepare text (with optional lowercase) */
-				display_text = prepare_menu_text(item, text_buffer, sizeof(text_buffer));
-				
-				/* Center all text */
-#ifdef XFT
-				tx = (wide - get_text_width(display_text)) / 2;
-				ty = i * high + get_font_ascent() + 1;
-				draw_text(s, s->menuwin, tx, ty, display_text, 0);
-#else
-				tx = (wide - XTextWidth(font, display_text, strlen(display_text))) / 2;
-				ty = i * high + font->ascent + 1;
-				XDrawString(dpy, s->menuwin, s->text_gc, tx, ty, display_text, strlen(display_text));
-#endif
-			}
-			if (cur >= 0 && cur < n) {
-				/* Draw highlighted item */
-				char *item = m->item[cur];
-				char text_buffer[256];
-				char *display_text;
-				
-				/* Fill with blue background */
-				XFillRectangle(dpy, s->menuwin, s->menu_highlight_gc, 0, cur * high, wide, high);
-				
-				/* Prepare text (with optional lowercase) */
-				display_text = prepare_menu_text(item, text_buffer, sizeof(text_buffer));
-				
-				/* Center all text */
-#ifdef XFT
-				tx = (wide - get_text_width(display_text)) / 2;
-				ty = cur * high + get_font_ascent() + 1;
-				draw_text(s, s->menuwin, tx, ty, display_text, 1);
-#else
-				tx = (wide - XTextWidth(font, display_text, strlen(display_text))) / 2;
-				ty = cur * high + font->ascent + 1;
-				XDrawString(dpy, s->menuwin, s->menu_highlight_text_gc, tx, ty, display_text, strlen(display_text));
-#endif
-			}
+				XCopyArea(dpy, ms->normal, s->menuwin, s->copy_gc, 0, 0,
+				          wide, n * high, 0, 0);
+				if (cur >= 0 && cur < n)
+					menu_strip_row(s, ms, s->menuwin, cur, 1);
 			}
 			drawn = 1;
 		}
@@ -647,14 +725,16 @@ selectwin(int release, int *shift, ScreenInfo * s)
 		graberror("selectwin", status);	/* */
 		return 0;
 	}
+	modal_begin(0);
 	w = None;
 	for (;;) {
-		XMaskEvent(dpy, ButtonMask, &ev);
+		waitevent(None, &ev, ButtonMask, -1L);
 		e = &ev.xbutton;
 		switch (ev.type) {
 		case ButtonPress:
 			if (e->button != Button3) {
 				ungrab(e);
+				modal_end();
 				return 0;
 			}
 			w = e->subwindow;
@@ -664,11 +744,13 @@ selectwin(int release, int *shift, ScreenInfo * s)
 					ungrab(e);
 				if (shift != 0)
 					*shift = (e->state & ShiftMask) != 0;
+				modal_end();
 				return c;
 			}
 			break;
 		case ButtonRelease:
 			ungrab(e);
+			modal_end();
 			if (e->button != Button3 || e->subwindow != w)
 				return 0;
 			if (shift != 0)
@@ -720,17 +802,28 @@ dragcalc(Client * c, int x, int y)
 	c->y = y - c->drag_offset_y;
 }
 
-void
-drawbound(Client * c)
+/*
+ * Rubber-band outlines are four thin override-redirect windows, moved
+ * around rather than XORed onto the root, so nothing needs the server
+ * grabbed while they are up.
+ */
+static void
+bound_hide(ScreenInfo * s)
 {
-	int x, y, dx, dy;
-	ScreenInfo *s;
+	int i;
+
+	if (!s->bound_mapped)
+		return;
+	for (i = 0; i < 4; i++)
+		XUnmapWindow(dpy, s->bound[i]);
+	s->bound_mapped = 0;
+}
+
+static void
+bound_show(ScreenInfo * s, int x, int y, int dx, int dy)
+{
+	int i;
 
-	s = c->screen;
-	x = c->x - config.window_frame_width;
-	y = c->y - config.window_frame_width;
-	dx = c->dx + 2 * config.window_frame_width;
-	dy = c->dy + 2 * config.window_frame_width;
 	if (dx < 0) {
 		x += dx;
 		dx = -dx;
@@ -739,31 +832,247 @@ drawbound(Client * c)
 		y += dy;
 		dy = -dy;
 	}
-	if (dx <= 2 || dy <= 2)
+	if (dx <= 2 * BOUNDWIDTH || dy <= 2 * BOUNDWIDTH) {
+		bound_hide(s);
 		return;
-	XDrawRectangle(dpy, s->root, s->gc, x, y, dx - 1, dy - 1);
-	XDrawRectangle(dpy, s->root, s->gc, x + 1, y + 1, dx - 3, dy - 3);
+	}
+	XMoveResizeWindow(dpy, s->bound[0], x, y, dx, BOUNDWIDTH);
+	XMoveResizeWindow(dpy, s->bound[1], x, y + dy - BOUNDWIDTH, dx, BOUNDWIDTH);
+	XMoveResizeWindow(dpy, s->bound[2], x, y + BOUNDWIDTH, BOUNDWIDTH, dy - 2 * BOUNDWIDTH);
+	XMoveResizeWindow(dpy, s->bound[3], x + dx - BOUNDWIDTH, y + BOUNDWIDTH,
+	                  BOUNDWIDTH, dy - 2 * BOUNDWIDTH);
+	if (!s->bound_mapped) {
+		for (i = 0; i < 4; i++)
+			XMapRaised(dpy, s->bound[i]);
+		s->bound_mapped = 1;
+	}
+}
+
+void
+drawbound(Client * c)
+{
+	bound_show(c->screen, c->x - config.window_frame_width, c->y - config.window_frame_width,
+	           c->dx + 2 * config.window_frame_width, c->dy + 2 * config.window_frame_width);
+}
+
+/*
+ * The modal loops below, and the finder, read their events through
+ * waitevent().  What they ask for comes back to them; everything else
+ * goes to dispatch() as it arrives, so new windows still map and
+ * configure while a menu or a sweep is up.  Input for other windows,
+ * move and activate requests, and anything about the client being
+ * swept would pull the rug from under the interaction, so those are
+ * held until the outermost modal_end() puts them back on the queue
+ * for mainloop().
+ */
+int modal;
+static Client *modal_client;
+static int modal_keep;
+static XEvent *modal_held;
+static int modal_nheld, modal_maxheld;
+
+void
+modal_begin(Client * c)
+{
+	if (modal++ == 0)
+		modal_client = 0;
+	if (c)
+		modal_client = c;
+}
+
+/*
+ * Also hold whatever would remove, hide, unhide or rename a client.  The
+ * b3 menu lists hidden clients by their place in hiddenc[] and by their
+ * labels, so until it closes those have to stay as they were drawn.
+ */
+void
+modal_keepclients(void)
+{
+	modal_keep = 1;
 }
 
+/* The loop has grabbed the keyboard for w */
 void
-misleep(int msec)
+modal_keys(Window w)
 {
-	struct timeval t;
+	modal_keyboard = w;
+}
 
-	t.tv_sec = msec / 1000;
-	t.tv_usec = (msec % 1000) * 1000;
-	select(0, 0, 0, 0, &t);
+void
+modal_end(void)
+{
+	if (--modal > 0)
+		return;
+	modal_client = 0;
+	modal_keep = 0;
+	modal_pointer = modal_keyboard = None;
+	/* Each one goes to the head of the queue, so last first */
+	while (modal_nheld > 0)
+		XPutBackEvent(dpy, &modal_held[--modal_nheld]);
+}
+
+/*
+ * 1 to hold ev until modal_end(), 0 to dispatch it now, -1 to drop it.
+ * Input reported to the window the loop grabbed was meant for the loop;
+ * whatever of it the loop did not ask for is spent, not replayed later.
+ */
+static int
+modal_holds(XEvent * ev)
+{
+	switch (ev->type) {
+	case ButtonPress:
+	case ButtonRelease:
+	case MotionNotify:
+		return ev->xany.window == modal_pointer ? -1 : 1;
+	case KeyPress:
+	case KeyRelease:
+		return ev->xany.window == modal_keyboard ? -1 : 1;
+	case ClientMessage:
+		if (ev->xclient.message_type == wm_moveresize ||
+		    ev->xclient.message_type == active_window)
+			return 1;
+		if (ev->xclient.message_type == wm_change_state && modal_keep)
+			return 1;
+		break;
+	case MapRequest:
+	case UnmapNotify:
+	case DestroyNotify:
+	case PropertyNotify:
+		if (modal_keep)
+			return 1;
+		break;
+	}
+	return modal_client != 0 && getclient(ev->xany.window, 0) == modal_client;
+}
+
+static void
+modal_hold(XEvent * ev)
+{
+	XEvent *grown;
+
+	if (modal_nheld == modal_maxheld) {
+		grown = (XEvent *) realloc(modal_held, (modal_maxheld * 2 + 16) * sizeof(XEvent));
+		if (grown == 0) {
+			fprintf(stderr, "9wm: modal: out of memory, dropping ev.type %d\n", ev->type);
+			return;
+		}
+		modal_held = grown;
+		modal_maxheld = modal_maxheld * 2 + 16;
+	}
+	modal_held[modal_nheld++] = *ev;
+}
+
+/*
+ * Take an event matching mask (for window w, unless it is None) from
+ * the queue, handing over or holding whatever is ahead of it.  Returns
+ * 0 once the queue is empty without one turning up.  Only for use
+ * between modal_begin() and modal_end().
+ */
+int
+modalevent(Window w, XEvent * ev, long mask)
+{
+	XEvent other;
+
+	for (;;) {
+		if (w != None ? XCheckWindowEvent(dpy, w, mask, ev) : XCheckMaskEvent(dpy, mask, ev))
+			return 1;
+		if (QLength(dpy) == 0)
+			return 0;
+		XNextEvent(dpy, &other);
+		switch (modal_holds(&other)) {
+		case 1:
+			modal_hold(&other);
+			break;
+		case 0:
+			dispatch(&other);
+			break;
+		}
+	}
+}
+
+/*
+ * Like XWindowEvent, or XMaskEvent when w is None, but give up at
+ * deadline (an mstime() value, or negative for never).  Returns 1 with
+ * an event in ev, 0 on timeout.  Sleeps in select() on the display
+ * connection rather than polling.
+ */
+int
+waitevent(Window w, XEvent * ev, long mask, long deadline)
+{
+	struct timeval t, *tp;
+	fd_set rfds;
+	long left;
+	int fd;
+
+	fd = ConnectionNumber(dpy);
+	for (;;) {
+		if (modalevent(w, ev, mask))
+			return 1;
+		tp = NULL;
+		if (deadline >= 0) {
+			if ((left = deadline - mstime()) <= 0)
+				return 0;
+			t.tv_sec = left / 1000;
+			t.tv_usec = (left % 1000) * 1000;
+			tp = &t;
+		}
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		if (select(fd + 1, &rfds, NULL, NULL, tp) < 0 && errno != EINTR) {
+			perror("9wm: waitevent: select failed");
+			if (deadline >= 0)
+				return 0;
+			if (w != None)
+				XWindowEvent(dpy, w, mask, ev);
+			else
+				XMaskEvent(dpy, mask, ev);
+			return 1;
+		}
+	}
+}
+
+/*
+ * Turn the outline sweepdrag() is tracking (border included, possibly
+ * inside out) into a window geometry and hand it to opaque.c.
+ */
+static void
+sweepdrag_opaque(Client * c)
+{
+	int x, y, dx, dy;
+
+	x = c->x;
+	y = c->y;
+	dx = c->dx;
+	dy = c->dy;
+	if (dx < 0) {
+		x += dx;
+		dx = -dx;
+	}
+	if (dy < 0) {
+		y += dy;
+		dy = -dy;
+	}
+	dx -= 2 * BORDER;
+	dy -= 2 * BORDER;
+	if (dx < 4 || dy < 4 || dx < c->min_dx || dy < c->min_dy)
+		return;
+	opaque_moveresize(x + BORDER, y + BORDER, dx, dy);
 }
 
 int
 sweepdrag(Client * c, XButtonEvent * e0, void (*recalc) ())
 {
 	XEvent ev;
-	int idle;
 	int cx, cy, rx, ry;
 	int ox, oy, odx, ody;
+	int opaque;
 	XButtonEvent *e;
 
+	modal_begin(c);
+	/* Windows not yet on screen still get placed with an outline */
+	opaque = config.opaque_move && normal(c);
+	if (opaque)
+		opaque_begin(c);
 	ox = c->x;
 	oy = c->y;
 	odx = c->dx;
@@ -778,37 +1087,43 @@ sweepdrag(Client * c, XButtonEvent * e0, void (*recalc) ())
 		recalc(c, e0->x, e0->y);
 	} else
 		getmouse(&cx, &cy, c->screen);
-	XGrabServer(dpy);
-	drawbound(c);
-	idle = 0;
+	/* Follow the pointer by its motion events rather than by polling it */
+	XChangeActivePointerGrab(dpy, ButtonMask | PointerMotionMask, c->screen->boxcurs, CurrentTime);
+	if (!opaque)
+		drawbound(c);
 	for (;;) {
-		if (XCheckMaskEvent(dpy, ButtonMask, &ev) == 0) {
-			getmouse(&rx, &ry, c->screen);
-			if (rx != cx || ry != cy || ++idle > 300) {
-				drawbound(c);
-				if (rx == cx && ry == cy) {
-					XUngrabServer(dpy);
-					XFlush(dpy);
-					misleep(500);
-					XGrabServer(dpy);
-					idle = 0;
-				}
+		if (opaque)
+			opaque_wait(&ev, ButtonMask | PointerMotionMask);
+		else
+			waitevent(None, &ev, ButtonMask | PointerMotionMask, -1L);
+		if (ev.type == MotionNotify) {
+			/* Only the latest position matters */
+			motion_compress(&ev);
+			rx = ev.xmotion.x_root;
+			ry = ev.xmotion.y_root;
+			if (rx == cx && ry == cy)
+				continue;
+			cx = rx;
+			cy = ry;
+			if (opaque) {
 				recalc(c, rx, ry);
-				cx = rx;
-				cy = ry;
-				drawbound(c);
-				XFlush(dpy);
+				sweepdrag_opaque(c);
+				continue;
 			}
-			misleep(50);
+			recalc(c, rx, ry);
+			drawbound(c);
+			XFlush(dpy);
 			continue;
 		}
 		e = &ev.xbutton;
 		switch (ev.type) {
 		case ButtonPress:
 		case ButtonRelease:
-			drawbound(c);
+			if (opaque)
+				opaque_end();
+			else
+				bound_hide(c->screen);
 			ungrab(e);
-			XUngrabServer(dpy);
 			recalc(c, ev.xbutton.x, ev.xbutton.y);
 			if (c->dx < 0) {
 				c->x += c->dx;
@@ -824,6 +1139,9 @@ sweepdrag(Client * c, XButtonEvent * e0, void (*recalc) ())
 			c->dy -= 2 * BORDER;
 			if (c->dx < 4 || c->dy < 4 || c->dx < c->min_dx || c->dy < c->min_dy)
 				goto bad;
+			if (opaque)
+				opaque_apply(c, c->x, c->y, c->dx, c->dy, 1);
+			modal_end();
 			return 1;
 		}
 	}
@@ -832,6 +1150,9 @@ sweepdrag(Client * c, XButtonEvent * e0, void (*recalc) ())
 	c->y = oy;
 	c->dx = odx;
 	c->dy = ody;
+	if (opaque)
+		opaque_apply(c, c->x, c->y, c->dx, c->dy, 1);
+	modal_end();
 	return 0;
 }
 
@@ -839,7 +1160,7 @@ int
 sweep(Client * c)
 {
 	XEvent ev;
-	int status;
+	int status, r;
 	XButtonEvent *e;
 	ScreenInfo *s;
 
@@ -850,16 +1171,20 @@ sweep(Client * c)
 		return 0;
 	}
 
-	XMaskEvent(dpy, ButtonMask, &ev);
+	modal_begin(c);
+	waitevent(None, &ev, ButtonMask, -1L);
 	e = &ev.xbutton;
 	if (e->button != Button3) {
 		ungrab(e);
+		modal_end();
 		return 0;
 	}
 	if (c->size.flags & (PMinSize | PBaseSize))
 		setmouse(e->x + c->min_dx, e->y + c->min_dy, s);
 	XChangeActivePointerGrab(dpy, ButtonMask, s->boxcurs, e->time);
-	return sweepdrag(c, e, sweepcalc);
+	r = sweepdrag(c, e, sweepcalc);
+	modal_end();
+	return r;
 }
 
 int
@@ -908,7 +1233,6 @@ sweep_area(ScreenInfo * s, int *x, int *y, int *width, int *height)
 	XButtonEvent *e;
 	int x1, y1, x2, y2;
 	int pressed = 0;
-	int last_x2 = -1, last_y2 = -1;
 
 	status = grab(s->root, s->root, ButtonMask | PointerMotionMask, s->sweep0, 0);
 	if (status != GrabSuccess) {
@@ -916,17 +1240,16 @@ sweep_area(ScreenInfo * s, int *x, int *y, int *width, int *height)
 		return 0;
 	}
 
-	XGrabServer(dpy);
-
+	modal_begin(0);
 	for (;;) {
-		XMaskEvent(dpy, ButtonMask | PointerMotionMask, &ev);
+		waitevent(None, &ev, ButtonMask | PointerMotionMask, -1L);
 		e = &ev.xbutton;
 		
 		switch (ev.type) {
 		case ButtonPress:
 			if (e->button != Button3) {
-				XUngrabServer(dpy);
 				ungrab(e);
+				modal_end();
 				return 0;
 			}
 			x1 = e->x;
@@ -938,60 +1261,24 @@ sweep_area(ScreenInfo * s, int *x, int *y, int *width, int *height)
 		case MotionNotify:
 			if (!pressed)
 				break;
-			
-			/* Erase previous box */
-			if (last_x2 != -1) {
-				int dx = last_x2 - x1;
-				int dy = last_y2 - y1;
-				int rx = x1, ry = y1;
-				if (dx < 0) { rx = last_x2; dx = -dx; }
-				if (dy < 0) { ry = last_y2; dy = -dy; }
-				if (dx > 0 && dy > 0) {
-					XDrawRectangle(dpy, s->root, s->gc, rx, ry, dx, dy);
-				}
-			}
-			
-			/* Draw new box */
-			x2 = ev.xmotion.x;
-			y2 = ev.xmotion.y;
-			{
-				int dx = x2 - x1;
-				int dy = y2 - y1;
-				int rx = x1, ry = y1;
-				if (dx < 0) { rx = x2; dx = -dx; }
-				if (dy < 0) { ry = y2; dy = -dy; }
-				if (dx > 0 && dy > 0) {
-					XDrawRectangle(dpy, s->root, s->gc, rx, ry, dx, dy);
-				}
-			}
-			last_x2 = x2;
-			last_y2 = y2;
+			/* Only the latest position matters */
+			motion_compress(&ev);
+			bound_show(s, x1, y1, ev.xmotion.x - x1, ev.xmotion.y - y1);
 			XFlush(dpy);
 			break;
 			
 		case ButtonRelease:
+			bound_hide(s);
 			if (!pressed || e->button != Button3) {
-				XUngrabServer(dpy);
 				ungrab(e);
+				modal_end();
 				return 0;
 			}
 			
-			/* Erase final box */
-			if (last_x2 != -1) {
-				int dx = last_x2 - x1;
-				int dy = last_y2 - y1;
-				int rx = x1, ry = y1;
-				if (dx < 0) { rx = last_x2; dx = -dx; }
-				if (dy < 0) { ry = last_y2; dy = -dy; }
-				if (dx > 0 && dy > 0) {
-					XDrawRectangle(dpy, s->root, s->gc, rx, ry, dx, dy);
-				}
-			}
-			
 			x2 = e->x;
 			y2 = e->y;
-			XUngrabServer(dpy);
 			ungrab(e);
+			modal_end();
 			
 			if (x1 > x2) { int tmp = x1; x1 = x2; x2 = tmp; }
 			if (y1 > y2) { int tmp = y1; y1 = y2; y2 = tmp; }
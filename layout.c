@@ -0,0 +1,437 @@
+/*
+ * Tiling layouts for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ *
+ * Each layout is a pure function from a list of clients and an area to
+ * one box per client.  layout_arrange() gathers the clients of a
+ * workspace on each monitor (the focused one first, as master), asks
+ * the workspace's layout for their boxes within that monitor, fits
+ * each box to its client's size hints and layout_commit() then sends
+ * them all in one pass with a single flush.  A client given a size its
+ * hints allow has nothing to ask back for, so a tile settles without a
+ * round of ConfigureRequests.
+ *
+ * On a workspace with autotile set, layout_touch() marks it for a
+ * relayout whenever a client arrives, leaves, hides or unhides.  The
+ * relayout waits until events have been quiet for LAYOUT_SETTLE_MS, so
+ * a script opening ten windows costs one relayout, not ten; getevent()
+ * runs it from its idle wait.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include "dat.h"
+#include "fns.h"
+#include "workspace.h"
+#include "layout.h"
+#include "monitor.h"
+
+/* Quiet time that ends a burst, and the longest a burst may hold a relayout back */
+#define LAYOUT_SETTLE_MS	30
+#define LAYOUT_MAX_WAIT_MS	200
+
+static Client **lcl;
+static LayoutBox *lbox;
+static int lmax;
+
+static unsigned char layout_dirty[MAX_WORKSPACES];
+static long layout_since;	/* mstime() of the first touch of the burst, 0 when none */
+static long layout_due;
+
+/* The i'th of k even parts of len from start; leftover pixels go to the later parts */
+static void
+layout_split(int start, int len, int k, int i, int *pos, int *size)
+{
+	*pos = start + (int) ((long) len * i / k);
+	*size = start + (int) ((long) len * (i + 1) / k) - *pos;
+}
+
+static void
+layout_rows(LayoutBox *area, int x, int dx, int k, LayoutBox *out)
+{
+	int i;
+
+	for (i = 0; i < k; i++) {
+		out[i].x = x;
+		out[i].dx = dx;
+		layout_split(area->y, area->dy, k, i, &out[i].y, &out[i].dy);
+	}
+}
+
+/* One window fills the area, two split 60/40, more stack beside a half-width master */
+static void
+layout_master(Client **cl, int n, LayoutBox *area, LayoutBox *out)
+{
+	int mw;
+
+	if (n == 1) {
+		out[0] = *area;
+		return;
+	}
+	mw = n == 2 ? area->dx * 6 / 10 : area->dx / 2;
+	out[0] = *area;
+	out[0].dx = mw;
+	layout_rows(area, area->x + mw, area->dx - mw, n - 1, out + 1);
+}
+
+/* As square as possible; a short last row spreads across the width */
+static void
+layout_grid(Client **cl, int n, LayoutBox *area, LayoutBox *out)
+{
+	int cols, rows, r, c, k, i, y, dy;
+
+	for (cols = 1; cols * cols < n; cols++)
+		;
+	rows = (n + cols - 1) / cols;
+	for (i = r = 0; r < rows; r++) {
+		k = r < rows - 1 ? cols : n - cols * (rows - 1);
+		layout_split(area->y, area->dy, rows, r, &y, &dy);
+		for (c = 0; c < k; c++, i++) {
+			layout_split(area->x, area->dx, k, c, &out[i].x, &out[i].dx);
+			out[i].y = y;
+			out[i].dy = dy;
+		}
+	}
+}
+
+static void
+layout_columns(Client **cl, int n, LayoutBox *area, LayoutBox *out)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		layout_split(area->x, area->dx, n, i, &out[i].x, &out[i].dx);
+		out[i].y = area->y;
+		out[i].dy = area->dy;
+	}
+}
+
+static void
+layout_monocle(Client **cl, int n, LayoutBox *area, LayoutBox *out)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		out[i] = *area;
+}
+
+/* Each window takes half of what is left, turning left, top, right, bottom */
+static void
+layout_spiral(Client **cl, int n, LayoutBox *area, LayoutBox *out)
+{
+	LayoutBox r;
+	int i, half;
+
+	r = *area;
+	for (i = 0; i < n - 1; i++) {
+		out[i] = r;
+		switch (i % 4) {
+		case 0:
+			half = r.dx / 2;
+			out[i].dx = half;
+			r.x += half;
+			r.dx -= half;
+			break;
+		case 1:
+			half = r.dy / 2;
+			out[i].dy = half;
+			r.y += half;
+			r.dy -= half;
+			break;
+		case 2:
+			half = r.dx / 2;
+			out[i].x = r.x + r.dx - half;
+			out[i].dx = half;
+			r.dx -= half;
+			break;
+		case 3:
+			half = r.dy / 2;
+			out[i].y = r.y + r.dy - half;
+			out[i].dy = half;
+			r.dy -= half;
+			break;
+		}
+	}
+	out[n - 1] = r;
+}
+
+/* Master in the middle half, the others alternating left and right of it */
+static void
+layout_centered(Client **cl, int n, LayoutBox *area, LayoutBox *out)
+{
+	LayoutBox tmp[2];
+	int i, nleft, nright, lw, mw, l, r;
+
+	if (n == 1) {
+		out[0] = *area;
+		return;
+	}
+	if (n == 2) {
+		layout_columns(cl, 2, area, tmp);
+		out[0] = tmp[1];
+		out[1] = tmp[0];
+		return;
+	}
+	lw = area->dx / 4;
+	mw = area->dx / 2;
+	out[0] = *area;
+	out[0].x = area->x + lw;
+	out[0].dx = mw;
+	nleft = n / 2;
+	nright = (n - 1) / 2;
+	for (i = 1, l = r = 0; i < n; i++) {
+		if (i & 1) {
+			out[i].x = area->x;
+			out[i].dx = lw;
+			layout_split(area->y, area->dy, nleft, l++, &out[i].y, &out[i].dy);
+		} else {
+			out[i].x = area->x + lw + mw;
+			out[i].dx = area->dx - lw - mw;
+			layout_split(area->y, area->dy, nright, r++, &out[i].y, &out[i].dy);
+		}
+	}
+}
+
+Layout layouts[] = {
+	{ "master", layout_master },
+	{ "grid", layout_grid },
+	{ "columns", layout_columns },
+	{ "monocle", layout_monocle },
+	{ "spiral", layout_spiral },
+	{ "centered", layout_centered },
+};
+int nlayouts = sizeof(layouts) / sizeof(layouts[0]);
+
+int
+layout_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < nlayouts; i++)
+		if (strcmp(layouts[i].name, name) == 0)
+			return i;
+	return -1;
+}
+
+/*
+ * Shrink box b to the largest size within it that c's increments and
+ * maximum allow, splitting what is left over evenly around it.  The
+ * minimum size wins over the box.
+ */
+void
+layout_hints(Client *c, LayoutBox *b)
+{
+	XSizeHints *h;
+	int dx, dy;
+
+	h = &c->size;
+	dx = b->dx;
+	dy = b->dy;
+	if ((h->flags & PMaxSize) && h->max_width > 0 && h->max_height > 0) {
+		if (dx > h->max_width)
+			dx = h->max_width;
+		if (dy > h->max_height)
+			dy = h->max_height;
+	}
+	if (h->flags & PResizeInc) {
+		if (h->width_inc > 1 && dx > c->min_dx)
+			dx = c->min_dx + (dx - c->min_dx) / h->width_inc * h->width_inc;
+		if (h->height_inc > 1 && dy > c->min_dy)
+			dy = c->min_dy + (dy - c->min_dy) / h->height_inc * h->height_inc;
+	}
+	if (h->flags & PMinSize) {
+		if (dx < h->min_width)
+			dx = h->min_width;
+		if (dy < h->min_height)
+			dy = h->min_height;
+	}
+	if (dx < 1)
+		dx = 1;
+	if (dy < 1)
+		dy = 1;
+	b->x += (b->dx - dx) / 2;
+	b->y += (b->dy - dy) / 2;
+	b->dx = dx;
+	b->dy = dy;
+}
+
+/*
+ * The clients layout_arrange() would tile on workspace ws of monitor m
+ * of s, the focused one first.  The list is owned here and good until
+ * the next call.
+ */
+int
+layout_collect(ScreenInfo *s, int ws, Monitor *m, Client ***cl)
+{
+	Client *c, **grown;
+	LayoutBox *bgrown;
+	int i, n;
+
+	n = 0;
+	for (c = clients; c; c = c->next) {
+		if (hidden(c) || withdrawn(c) || c->screen != s || c->workspace != ws)
+			continue;
+		if (m && monitor_of(c) != m)
+			continue;
+		if (n == lmax) {
+			grown = (Client **) realloc(lcl, (lmax * 2 + 16) * sizeof(Client *));
+			if (grown == 0)
+				break;
+			lcl = grown;
+			bgrown = (LayoutBox *) realloc(lbox, (lmax * 2 + 16) * sizeof(LayoutBox));
+			if (bgrown == 0)
+				break;
+			lbox = bgrown;
+			lmax = lmax * 2 + 16;
+		}
+		lcl[n++] = c;
+	}
+	/* The focused window is master; the rest keep their order */
+	for (i = 1; i < n && lcl[i] != current; i++)
+		;
+	if (i < n) {
+		memmove(lcl + 1, lcl, i * sizeof(Client *));
+		lcl[0] = current;
+	}
+	*cl = lcl;
+	return n;
+}
+
+/*
+ * Give each client its box, all in one go, leaving alone those already
+ * there.  Returns how many were sent.
+ */
+int
+layout_commit(Client **cl, LayoutBox *box, int n)
+{
+	Client *c;
+	int i, sent;
+
+	for (i = sent = 0; i < n; i++) {
+		c = cl[i];
+		if (c->x == box[i].x && c->y == box[i].y && c->dx == box[i].dx && c->dy == box[i].dy)
+			continue;
+		sent++;
+		c->x = box[i].x;
+		c->y = box[i].y;
+		c->dx = box[i].dx;
+		c->dy = box[i].dy;
+		XMoveResizeWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER,
+		                  c->dx + 2 * (BORDER - 1), c->dy + 2 * (BORDER - 1));
+		XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
+		sendconfig(c);
+	}
+	if (sent)
+		XFlush(dpy);
+	return sent;
+}
+
+void
+layout_arrange(ScreenInfo *s, int ws)
+{
+	LayoutBox area;
+	Monitor *m;
+	Client **cl;
+	int n, l, i, k;
+
+	if (s == 0 || ws < 0 || ws >= MAX_WORKSPACES)
+		return;
+	l = workspaces[ws].layout;
+	if (l < 0 || l >= nlayouts)
+		l = 0;
+	if (s->nmonitors == 0)
+		monitor_update(s);
+	/* Each head is tiled on its own, with the windows whose middle is on it */
+	for (k = 0; k < s->nmonitors; k++) {
+		m = &s->monitors[k];
+		if ((n = layout_collect(s, ws, m, &cl)) == 0)
+			continue;
+		area.x = m->x;
+		area.y = m->y;
+		area.dx = m->width;
+		area.dy = m->height;
+		layouts[l].arrange(cl, n, &area, lbox);
+		for (i = 0; i < n; i++)
+			layout_hints(cl[i], &lbox[i]);
+		layout_commit(cl, lbox, n);
+	}
+}
+
+/* Pick the layout of workspace ws by name, or the next one when name is empty, and tile */
+void
+layout_set(ScreenInfo *s, int ws, const char *name)
+{
+	int l;
+
+	if (ws < 0 || ws >= MAX_WORKSPACES)
+		return;
+	if (name == 0 || *name == '\0') {
+		l = (workspaces[ws].layout + 1) % nlayouts;
+	} else if ((l = layout_find(name)) < 0) {
+		fprintf(stderr, "9wm: unknown layout '%s'\n", name);
+		return;
+	}
+	workspaces[ws].layout = l;
+	layout_arrange(s, ws);
+}
+
+/* Workspace ws has gained or lost a tiled client; relayout it once things settle */
+void
+layout_touch(int ws)
+{
+	long now;
+
+	if (ws < 0 || ws >= MAX_WORKSPACES || !workspaces[ws].autotile)
+		return;
+	now = mstime();
+	if (layout_since == 0)
+		layout_since = now;
+	layout_dirty[ws] = 1;
+	layout_due = now + LAYOUT_SETTLE_MS;
+	if (layout_due > layout_since + LAYOUT_MAX_WAIT_MS)
+		layout_due = layout_since + LAYOUT_MAX_WAIT_MS;
+}
+
+/* Milliseconds until layout_flush() has work, or -1 if it has none */
+int
+layout_timeout(void)
+{
+	long left;
+
+	if (layout_since == 0)
+		return -1;
+	left = layout_due - mstime();
+	return left > 0 ? (int) left : 0;
+}
+
+void
+layout_flush(void)
+{
+	int ws, i;
+
+	if (layout_since == 0 || mstime() < layout_due)
+		return;
+	layout_since = 0;
+	for (ws = 0; ws < MAX_WORKSPACES; ws++) {
+		if (!layout_dirty[ws])
+			continue;
+		layout_dirty[ws] = 0;
+		for (i = 0; i < num_screens; i++)
+			layout_arrange(&screens[i], ws);
+	}
+}
+
+/* Turn autotile on or off for workspace ws, tiling it straight away when it goes on */
+void
+layout_autotile(ScreenInfo *s, int ws)
+{
+	if (ws < 0 || ws >= MAX_WORKSPACES)
+		return;
+	workspaces[ws].autotile = !workspaces[ws].autotile;
+	if (workspaces[ws].autotile)
+		layout_arrange(s, ws);
+}
@@ -0,0 +1,43 @@
+/*
+ * Tiling layouts for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <X11/Xlib.h>
+
+typedef struct LayoutBox LayoutBox;
+typedef struct Layout Layout;
+
+/* Client geometry as in c->x, c->y, c->dx, c->dy: inside the border */
+struct LayoutBox {
+	int x, y, dx, dy;
+};
+
+/*
+ * A layout only computes: given n clients, master first, and the area
+ * to fill, it writes one box per client and touches nothing else.
+ */
+struct Layout {
+	char *name;
+	void (*arrange)(Client **cl, int n, LayoutBox *area, LayoutBox *out);
+};
+
+extern Layout layouts[];
+extern int nlayouts;
+
+/* Function prototypes */
+int layout_find(const char *name);
+void layout_hints(Client *c, LayoutBox *b);
+int layout_collect(ScreenInfo *s, int ws, Monitor *m, Client ***cl);
+int layout_commit(Client **cl, LayoutBox *box, int n);
+void layout_arrange(ScreenInfo *s, int ws);
+void layout_set(ScreenInfo *s, int ws, const char *name);
+void layout_touch(int ws);
+int layout_timeout(void);
+void layout_flush(void);
+void layout_autotile(ScreenInfo *s, int ws);
+
+#endif /* LAYOUT_H */
@@ -14,6 +14,7 @@
 #include "workspace.h"
 #include "config.h"
 #include "plumb.h"
+#include "monitor.h"
 
 
 static void check_terminal_launch(Client *c);
@@ -54,6 +55,7 @@ manage(Client * c, int mapped)
 	c->iconname = getprop(c->window, XA_WM_ICON_NAME);
 	c->name = getprop(c->window, XA_WM_NAME);
 	setlabel(c);
+	finder_update(c);
 
 	hints = XGetWMHints(dpy, c->window);
 	if (XGetWMNormalHints(dpy, c->window, &c->size, &msize) == 0 || c->size.flags == 0)
@@ -103,27 +105,28 @@ manage(Client * c, int mapped)
 	 */
 
 	if (doreshape) {
-		int xmax = DisplayWidth(dpy, c->screen->num);
-		int ymax = DisplayHeight(dpy, c->screen->num);
+		Monitor *m;
 		int x, y;
 
+		/* Centred on the mouse, kept within the head it is on */
 		getmouse(&x, &y, c->screen);
+		m = monitor_at(c->screen, x, y);
 
 		c->x = x - (c->dx / 2);
 		c->y = y - (c->dy / 2);
 
-		if (c->x + c->dx > xmax) {
-			c->x = xmax - c->dx;
+		if (c->x + c->dx > m->x + m->width) {
+			c->x = m->x + m->width - c->dx;
 		}
-		if (c->x < 0) {
-			c->x = 0;
+		if (c->x < m->x) {
+			c->x = m->x;
 		}
 
-		if (c->y + c->dy > ymax) {
-			c->y = ymax - c->dy;
+		if (c->y + c->dy > m->y + m->height) {
+			c->y = m->y + m->height - c->dy;
 		}
-		if (c->y < 0) {
-			c->y = 0;
+		if (c->y < m->y) {
+			c->y = m->y;
 		}
 	}
 	gravitate(c, 0);
@@ -165,10 +168,10 @@ manage(Client * c, int mapped)
 		create_titlebar(c);
 	}
 	
-	/* Add client to current workspace BEFORE visibility operations */
+	/* Add client to the workspace its head shows BEFORE visibility operations */
 	fprintf(stderr, "manage: adding new client %p (window=0x%lx) to current workspace %d\n", 
-		(void*)c, c->window, workspace_get_current());
-	workspace_add_client(c, workspace_get_current());
+		(void*)c, c->window, monitor_of(c)->workspace);
+	workspace_add_client(c, monitor_of(c)->workspace);
 	
 	if (dohide)
 		hide(c);
@@ -187,9 +190,9 @@ manage(Client * c, int mapped)
 		setwstate(c, NormalState);
 		
 		/* Check if window was added to non-current workspace and hide it */
-		if (c->workspace != workspace_get_current()) {
+		if (!workspace_shown(c)) {
 			fprintf(stderr, "manage: unmapping window that was added to non-current workspace %d (current=%d)\n", 
-				c->workspace, workspace_get_current());
+				c->workspace, monitor_of(c)->workspace);
 			XUnmapWindow(dpy, c->parent);
 			XUnmapWindow(dpy, c->window);
 		} else {
@@ -208,8 +211,11 @@ manage(Client * c, int mapped)
 		check_terminal_launch(c);
 	}
 	
-	/* Check if we should auto-reshape this window (for interactive terminal spawn) */
-	if (auto_reshape_next && !dohide) {
+	/*
+	 * Check if we should auto-reshape this window (for interactive terminal spawn).
+	 * Not while a menu or sweep is up; the next window mapped gets it instead.
+	 */
+	if (auto_reshape_next && !dohide && !modal) {
 		auto_reshape_next = 0;  /* Reset the flag */
 		/* Give the window a moment to be ready */
 		XFlush(dpy);
@@ -589,8 +595,11 @@ getproto(Client * c)
 			c->proto |= Pdelete;
 		else if (p[i] == wm_take_focus)
 			c->proto |= Ptakefocus;
+		else if (p[i] == net_wm_sync_request)
+			c->proto |= Psyncrequest;
 
 	XFree((char *) p);
+	opaque_getcounter(c);
 }
 
 static Client*
@@ -16,6 +16,8 @@
 #include "fns.h"
 #include "config.h"
 #include "spaces.h"
+#include "layout.h"
+#include "monitor.h"
 
 Client *hiddenc[MAXHIDDEN];
 
@@ -61,8 +63,10 @@ build_submenu(int menu_idx)
 int
 show_submenu_at(XButtonEvent *e, int menu_idx, ScreenInfo *s, int main_x, int main_y, int main_width, int item_height)
 {
-	int sub_dx = 0, sub_dy, n, i, wide;
+	int sub_dx, sub_dy, n;
 	int x, y;
+	MenuStrip *ms;
+	Monitor *m;
 	
 	if (menu_idx < 0 || menu_idx >= config.menu_count || 
 	    !config.menu_items[menu_idx].is_folder ||
@@ -72,39 +76,26 @@ show_submenu_at(XButtonEvent *e, int menu_idx, ScreenInfo *s, int main_x, int ma
 	
 	build_submenu(menu_idx);
 	
-	/* Calculate submenu dimensions */
-	for (n = 0; submenu.item[n]; n++) {
-#ifdef XFT
-		wide = get_text_width(submenu.item[n]) + 4;
-#else
-		wide = XTextWidth(font, submenu.item[n], strlen(submenu.item[n])) + 4;
-#endif
-		if (wide > sub_dx)
-			sub_dx = wide;
-	}
-	
+	/* Dimensions come from the strip the submenu will be drawn from */
+	ms = menu_strip(s, &s->substrip, submenu.item);
+	n = ms->n;
 	if (n == 0) return -1;
-	
-#ifdef XFT
-	sub_dy = n * (get_font_ascent() + get_font_descent() + 1);
-#else
-	sub_dy = n * (font->ascent + font->descent + 1);
-#endif
+	sub_dx = ms->wide;
+	sub_dy = n * ms->high;
 	
 	/* Position submenu next to main menu */
 	x = main_x + main_width;
 	y = main_y + menu_idx * item_height;
 	
 	
-	/* Keep submenu on screen */
-	int xmax = DisplayWidth(dpy, s->num);
-	int ymax = DisplayHeight(dpy, s->num);
+	/* Keep submenu on the main menu's head */
+	m = monitor_at(s, main_x, main_y);
 	
-	if (x + sub_dx >= xmax)
+	if (x + sub_dx >= m->x + m->width)
 		x = main_x - sub_dx;
-	if (y + sub_dy >= ymax)
-		y = ymax - sub_dy;
-	if (y < 0) y = 0;
+	if (y + sub_dy >= m->y + m->height)
+		y = m->y + m->height - sub_dy;
+	if (y < m->y) y = m->y;
 	
 	/* Show submenu */
 	XMoveResizeWindow(dpy, s->submenuwin, x, y, sub_dx, sub_dy);
@@ -202,14 +193,14 @@ button(XButtonEvent * e)
 	
 	/* Handle spaces overlay clicks */
 	if (spaces_mode) {
-		if (e->window == spaces_view.overlay) {
+		if (e->window == spaces_view->overlay) {
 			spaces_handle_button(e);
 			return;
 		} else {
 			/* Safety check: if spaces_mode is on but event is not for overlay, 
 			   something is wrong - reset spaces mode */
 			spaces_mode = 0;
-			spaces_view.active = 0;
+			spaces_view->active = 0;
 		}
 	}
 	c = getclient(e->window, 0);
@@ -280,9 +271,16 @@ button(XButtonEvent * e)
 				} else if (strcmp(cmd, "hide") == 0) {
 					hide(selectwin(1, 0, s));
 				} else if (strcmp(cmd, "tile") == 0) {
-					tile_windows(s);
+					layout_arrange(s, workspace_get_current());
+				} else if (strncmp(cmd, "layout", 6) == 0 && (cmd[6] == '\0' || cmd[6] == ' ')) {
+					/* "layout" cycles, "layout grid" picks one */
+					layout_set(s, workspace_get_current(), cmd[6] ? cmd + 7 : "");
+				} else if (strcmp(cmd, "autotile") == 0) {
+					layout_autotile(s, workspace_get_current());
 				} else if (strcmp(cmd, "spaces") == 0) {
 					spaces_show(s);
+				} else if (strcmp(cmd, "finder") == 0) {
+					finder_show(s);
 				} else {
 					/* Custom command or folder */
 					if (config.menu_items[n].is_folder) {
@@ -386,12 +384,14 @@ spawn_terminal_interactive(ScreenInfo * s)
 int
 reshape_ex(Client *c, int activate)
 {
+	Monitor *from;
 	int odx, ody;
 
 	if (c == 0)
 		return 0;
 	odx = c->dx;
 	ody = c->dy;
+	from = monitor_of(c);
 	if (sweep(c) == 0)
 		return 0;
 	if (activate) {
@@ -404,6 +404,7 @@ reshape_ex(Client *c, int activate)
 		sendconfig(c);
 	else
 		XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
+	workspace_follow(c, from);
 	return 1;
 }
 
@@ -417,8 +418,11 @@ reshape(c)
 void
 move(Client * c)
 {
+	Monitor *from;
+
 	if (c == 0)
 		return;
+	from = monitor_of(c);
 	if (drag(c) == 0)
 		return;
 	active(c);
@@ -426,6 +430,8 @@ move(Client * c)
 	XRaiseWindow(dpy, c->parent);
 	XMoveWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER);
 	sendconfig(c);
+	/* Dropped on another head: it keeps its workspace, the head follows */
+	workspace_follow(c, from);
 }
 
 void
@@ -457,6 +463,7 @@ hide(Client * c)
 	setwstate(c, IconicState);
 	if (c == current)
 		nofocus();
+	layout_touch(c->workspace);
 
 	for (i = numhidden; i > 0; i -= 1) {
 		hiddenc[i] = hiddenc[i - 1];
@@ -493,6 +500,7 @@ unhide(int n, int map)
 	for (i = n; i < numhidden; i++) {
 		hiddenc[i] = hiddenc[i + 1];
 	}
+	layout_touch(c->workspace);
 }
 
 void
@@ -510,194 +518,6 @@ unhidec(c, map)
 	fprintf(stderr, "9wm: unhidec: not hidden: %s(0x%x)\n", c->label, (int) c->window);
 }
 
-void
-tile_windows(ScreenInfo *s)
-{
-	Client *c;
-	Client **visible_clients;
-	int num_visible = 0;
-	int i;
-	int screen_width, screen_height;
-	int master_width, slave_width;
-	int master_height, slave_height;
-	int master_x, master_y;
-	int slave_x, slave_y;
-	int current_workspace;
-	
-	if (!s) return;
-	
-	/* Get current workspace */
-	current_workspace = workspace_get_current();
-	
-	/* Count visible clients in current workspace */
-	for (c = clients; c; c = c->next) {
-		if (!hidden(c) && !withdrawn(c) && c->screen == s && c->workspace == current_workspace) {
-			num_visible++;
-		}
-	}
-	
-	if (num_visible == 0) return;
-	
-	/* Allocate array for visible clients */
-	visible_clients = malloc(num_visible * sizeof(Client*));
-	if (!visible_clients) return;
-	
-	/* Collect visible clients */
-	i = 0;
-	for (c = clients; c; c = c->next) {
-		if (!hidden(c) && !withdrawn(c) && c->screen == s && c->workspace == current_workspace) {
-			visible_clients[i++] = c;
-		}
-	}
-	
-	/* Get screen dimensions */
-	screen_width = DisplayWidth(dpy, s->num);
-	screen_height = DisplayHeight(dpy, s->num);
-	
-	if (num_visible == 1) {
-		/* Single window - full screen */
-		c = visible_clients[0];
-		c->x = 0;
-		c->y = 0;
-		c->dx = screen_width;
-		c->dy = screen_height;
-		
-		XMoveResizeWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER, 
-		                  c->dx + 2 * (BORDER - 1), c->dy + 2 * (BORDER - 1));
-		XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
-		sendconfig(c);
-		
-	} else if (num_visible == 2) {
-		/* Two windows - side by side, focused window gets more space */
-		master_width = (int)(screen_width * 0.6);  /* 60% for focused window */
-		slave_width = screen_width - master_width;
-		master_height = slave_height = screen_height;
-		master_x = 0;
-		master_y = 0;
-		slave_x = master_width;
-		slave_y = 0;
-		
-		/* Put current/focused window as master */
-		if (current && current->workspace == current_workspace) {
-			/* Current window gets master position */
-			current->x = master_x;
-			current->y = master_y;
-			current->dx = master_width;
-			current->dy = master_height;
-			
-			XMoveResizeWindow(dpy, current->parent, current->x - BORDER, current->y - BORDER,
-			                  current->dx + 2 * (BORDER - 1), current->dy + 2 * (BORDER - 1));
-			XMoveResizeWindow(dpy, current->window, BORDER - 1, BORDER - 1, current->dx, current->dy);
-			sendconfig(current);
-			
-			/* Other window gets slave position */
-			for (i = 0; i < num_visible; i++) {
-				if (visible_clients[i] != current) {
-					c = visible_clients[i];
-					c->x = slave_x;
-					c->y = slave_y;
-					c->dx = slave_width;
-					c->dy = slave_height;
-					
-					XMoveResizeWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER,
-					                  c->dx + 2 * (BORDER - 1), c->dy + 2 * (BORDER - 1));
-					XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
-					sendconfig(c);
-					break;
-				}
-			}
-		} else {
-			/* No current window, just split evenly */
-			master_width = screen_width / 2;
-			slave_width = screen_width - master_width;
-			
-			for (i = 0; i < num_visible && i < 2; i++) {
-				c = visible_clients[i];
-				c->x = (i == 0) ? 0 : master_width;
-				c->y = 0;
-				c->dx = (i == 0) ? master_width : slave_width;
-				c->dy = screen_height;
-				
-				XMoveResizeWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER,
-				                  c->dx + 2 * (BORDER - 1), c->dy + 2 * (BORDER - 1));
-				XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
-				sendconfig(c);
-			}
-		}
-		
-	} else {
-		/* Multiple windows - master/stack layout */
-		master_width = (int)(screen_width * 0.5);  /* 50% for master */
-		slave_width = screen_width - master_width;
-		master_height = screen_height;
-		slave_height = screen_height / (num_visible - 1);
-		
-		master_x = 0;
-		master_y = 0;
-		slave_x = master_width;
-		slave_y = 0;
-		
-		/* Put current/focused window as master if it exists */
-		if (current && current->workspace == current_workspace) {
-			current->x = master_x;
-			current->y = master_y;
-			current->dx = master_width;
-			current->dy = master_height;
-			
-			XMoveResizeWindow(dpy, current->parent, current->x - BORDER, current->y - BORDER,
-			                  current->dx + 2 * (BORDER - 1), current->dy + 2 * (BORDER - 1));
-			XMoveResizeWindow(dpy, current->window, BORDER - 1, BORDER - 1, current->dx, current->dy);
-			sendconfig(current);
-			
-			/* Stack other windows vertically */
-			i = 0;
-			for (c = clients; c; c = c->next) {
-				if (!hidden(c) && !withdrawn(c) && c->screen == s && 
-				    c->workspace == current_workspace && c != current) {
-					c->x = slave_x;
-					c->y = slave_y + (i * slave_height);
-					c->dx = slave_width;
-					c->dy = slave_height;
-					
-					XMoveResizeWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER,
-					                  c->dx + 2 * (BORDER - 1), c->dy + 2 * (BORDER - 1));
-					XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
-					sendconfig(c);
-					i++;
-				}
-			}
-		} else {
-			/* No current window, treat first as master */
-			visible_clients[0]->x = master_x;
-			visible_clients[0]->y = master_y;
-			visible_clients[0]->dx = master_width;
-			visible_clients[0]->dy = master_height;
-			
-			c = visible_clients[0];
-			XMoveResizeWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER,
-			                  c->dx + 2 * (BORDER - 1), c->dy + 2 * (BORDER - 1));
-			XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
-			sendconfig(c);
-			
-			/* Stack remaining windows */
-			for (i = 1; i < num_visible; i++) {
-				c = visible_clients[i];
-				c->x = slave_x;
-				c->y = slave_y + ((i - 1) * slave_height);
-				c->dx = slave_width;
-				c->dy = slave_height;
-				
-				XMoveResizeWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER,
-				                  c->dx + 2 * (BORDER - 1), c->dy + 2 * (BORDER - 1));
-				XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, c->dx, c->dy);
-				sendconfig(c);
-			}
-		}
-	}
-	
-	free(visible_clients);
-}
-
 void
 renamec(c, name)
      Client *c;
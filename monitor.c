@@ -0,0 +1,312 @@
+/*
+ * Monitor layout for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ *
+ * Each screen keeps a list of its heads, from RandR 1.5 monitors when
+ * built with -DRANDR, else from Xinerama when built with -DXINERAMA,
+ * else the whole screen as one.  Placement, menus, tiling, spaces and
+ * the finder ask for the monitor at a point or under a client rather
+ * than using the screen size.  Each head shows its own workspace; a
+ * client is on the head under its middle.  With RandR the list is refreshed on
+ * RRScreenChangeNotify; windows on heads that are still there, unchanged,
+ * stay where they are, the rest are moved onto the nearest remaining
+ * head (or re-tiled, on autotile workspaces).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#ifdef RANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+#ifdef XINERAMA
+#include <X11/extensions/Xinerama.h>
+#endif
+#include "dat.h"
+#include "fns.h"
+#include "workspace.h"
+#include "layout.h"
+#include "monitor.h"
+
+int monitor_event = -1;
+
+#ifdef RANDR
+static int monitor_randr;
+#endif
+#ifdef XINERAMA
+static int monitor_xinerama;
+#endif
+
+void
+monitor_init(void)
+{
+	int i;
+#if defined(RANDR) || defined(XINERAMA)
+	int event_base, error_base;
+#endif
+#ifdef RANDR
+	int major, minor;
+
+	if (XRRQueryExtension(dpy, &event_base, &error_base) &&
+	    XRRQueryVersion(dpy, &major, &minor) && (major > 1 || minor >= 5)) {
+		monitor_randr = 1;
+		monitor_event = event_base + RRScreenChangeNotify;
+		for (i = 0; i < num_screens; i++)
+			XRRSelectInput(dpy, screens[i].root, RRScreenChangeNotifyMask);
+	} else
+		fprintf(stderr, "monitor: RandR 1.5 not available\n");
+#endif
+#ifdef XINERAMA
+	if (XineramaQueryExtension(dpy, &event_base, &error_base) && XineramaIsActive(dpy))
+		monitor_xinerama = 1;
+#endif
+	for (i = 0; i < num_screens; i++)
+		monitor_update(&screens[i]);
+}
+
+/* Of the n monitors in list, the one holding x, y, or the nearest one when none does */
+static Monitor *
+monitor_find(Monitor *list, int n, int x, int y)
+{
+	Monitor *m, *best;
+	long d, bestd, dx, dy;
+	int i;
+
+	best = &list[0];
+	bestd = -1;
+	for (i = 0; i < n; i++) {
+		m = &list[i];
+		dx = x < m->x ? m->x - x : x >= m->x + m->width ? x - (m->x + m->width - 1) : 0;
+		dy = y < m->y ? m->y - y : y >= m->y + m->height ? y - (m->y + m->height - 1) : 0;
+		d = dx * dx + dy * dy;
+		if (d == 0)
+			return m;
+		if (bestd < 0 || d < bestd) {
+			best = m;
+			bestd = d;
+		}
+	}
+	return best;
+}
+
+static int
+monitor_same(Monitor *a, Monitor *b)
+{
+	return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
+/* Whether any of the first n heads in list shows ws */
+static int
+monitor_shows(Monitor *list, int n, int ws)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (list[i].workspace == ws)
+			return 1;
+	return 0;
+}
+
+/*
+ * Give the n heads in m their workspaces, each workspace to one head.  A
+ * head that is still where it was keeps its own; another takes that of
+ * the nearest old head, unless some head shows it already, and else the
+ * first workspace not shown anywhere.  Only with more heads than
+ * workspaces does one have to be shown twice.
+ */
+static void
+monitor_assign(Monitor *m, int n, Monitor *old, int nold)
+{
+	int i, k, ws;
+
+	for (k = 0; k < n; k++) {
+		m[k].workspace = -1;
+		for (i = 0; i < nold; i++)
+			if (monitor_same(&old[i], &m[k]) && !monitor_shows(m, n, old[i].workspace)) {
+				m[k].workspace = old[i].workspace;
+				break;
+			}
+	}
+	for (k = 0; k < n; k++) {
+		if (m[k].workspace >= 0)
+			continue;
+		ws = nold > 0 ? monitor_find(old, nold, m[k].x + m[k].width / 2,
+		                             m[k].y + m[k].height / 2)->workspace : 0;
+		if (monitor_shows(m, n, ws)) {
+			for (i = 0; i < workspace_count && monitor_shows(m, n, i); i++)
+				;
+			if (i < workspace_count)
+				ws = i;
+		}
+		m[k].workspace = ws;
+	}
+}
+
+/* Reread the heads of s */
+void
+monitor_update(ScreenInfo *s)
+{
+	Monitor old[MAXMONITORS], *m;
+	int n, nold;
+#if defined(RANDR) || defined(XINERAMA)
+	int i;
+#endif
+#ifdef RANDR
+	XRRMonitorInfo *rm;
+#endif
+#ifdef XINERAMA
+	XineramaScreenInfo *xi;
+#endif
+
+	nold = s->nmonitors;
+	memcpy(old, s->monitors, sizeof(old));
+	m = s->monitors;
+	n = 0;
+#ifdef RANDR
+	if (monitor_randr && (rm = XRRGetMonitors(dpy, s->root, True, &i)) != 0) {
+		for (n = 0; n < i && n < MAXMONITORS; n++) {
+			m[n].x = rm[n].x;
+			m[n].y = rm[n].y;
+			m[n].width = rm[n].width;
+			m[n].height = rm[n].height;
+		}
+		XRRFreeMonitors(rm);
+	}
+#endif
+#ifdef XINERAMA
+	/* Xinerama only ever describes a single combined screen */
+	if (n == 0 && monitor_xinerama && num_screens == 1 &&
+	    (xi = XineramaQueryScreens(dpy, &i)) != 0) {
+		for (n = 0; n < i && n < MAXMONITORS; n++) {
+			m[n].x = xi[n].x_org;
+			m[n].y = xi[n].y_org;
+			m[n].width = xi[n].width;
+			m[n].height = xi[n].height;
+		}
+		XFree(xi);
+	}
+#endif
+	if (n == 0) {
+		m[0].x = 0;
+		m[0].y = 0;
+		m[0].width = DisplayWidth(dpy, s->num);
+		m[0].height = DisplayHeight(dpy, s->num);
+		n = 1;
+	}
+	monitor_assign(m, n, old, nold);
+	s->nmonitors = n;
+	workspace_update_visible();
+}
+
+Monitor *
+monitor_at(ScreenInfo *s, int x, int y)
+{
+	if (s->nmonitors == 0)
+		monitor_update(s);
+	return monitor_find(s->monitors, s->nmonitors, x, y);
+}
+
+/* The monitor a client belongs to: the one under its middle */
+Monitor *
+monitor_of(Client *c)
+{
+	return monitor_at(c->screen, c->x + c->dx / 2, c->y + c->dy / 2);
+}
+
+Monitor *
+monitor_pointer(ScreenInfo *s)
+{
+	int x, y;
+
+	getmouse(&x, &y, s);
+	return monitor_at(s, x, y);
+}
+
+/* The head workspace keys act on: the focused window's, else the pointer's */
+Monitor *
+monitor_focused(ScreenInfo *s)
+{
+	if (current && current->screen == s)
+		return monitor_of(current);
+	return monitor_pointer(s);
+}
+
+#ifdef RANDR
+static int
+monitor_kept(ScreenInfo *s, Monitor *o)
+{
+	int i;
+
+	for (i = 0; i < s->nmonitors; i++)
+		if (monitor_same(&s->monitors[i], o))
+			return 1;
+	return 0;
+}
+#endif
+
+/*
+ * Heads were added, removed or changed.  Clients on a head that is still
+ * there as it was are left alone; the others are moved, keeping their
+ * offset from the head's corner, onto whichever head is now nearest,
+ * and shown or hidden by whether that head shows their workspace.
+ */
+void
+monitor_screenchange(XEvent *ev)
+{
+#ifdef RANDR
+	Monitor old[MAXMONITORS], *o, *m;
+	ScreenInfo *s;
+	Client *c;
+	int nold, x, y;
+
+	XRRUpdateConfiguration(ev);
+	s = getscreen(((XRRScreenChangeNotifyEvent *) ev)->root);
+	if (s == 0)
+		return;
+	nold = s->nmonitors;
+	memcpy(old, s->monitors, sizeof(old));
+	monitor_update(s);
+	/* With no old layout there is nothing to carry clients over from */
+	if (nold == 0)
+		return;
+
+	for (c = clients; c; c = c->next) {
+		if (c->screen != s || withdrawn(c))
+			continue;
+		/* The old head it was on, as monitor_of() would have said then */
+		o = monitor_find(old, nold, c->x + c->dx / 2, c->y + c->dy / 2);
+		if (monitor_kept(s, o))
+			continue;
+		m = monitor_at(s, c->x + c->dx / 2, c->y + c->dy / 2);
+		/* It keeps its workspace, which the head it lands on may not be showing */
+		if (c->workspace == o->workspace && c->workspace != m->workspace && normal(c)) {
+			workspace_switching = 1;
+			workspace_hide_client(c);
+		} else if (c->workspace != o->workspace && c->workspace == m->workspace)
+			workspace_show_client(c);
+		if (c->workspace >= 0 && workspaces[c->workspace].autotile) {
+			layout_touch(c->workspace);
+			continue;
+		}
+		x = m->x + (c->x - o->x);
+		y = m->y + (c->y - o->y);
+		if (x + c->dx > m->x + m->width)
+			x = m->x + m->width - c->dx;
+		if (x < m->x)
+			x = m->x;
+		if (y + c->dy > m->y + m->height)
+			y = m->y + m->height - c->dy;
+		if (y < m->y)
+			y = m->y;
+		if (x == c->x && y == c->y)
+			continue;
+		c->x = x;
+		c->y = y;
+		XMoveWindow(dpy, c->parent, c->x - BORDER, c->y - BORDER);
+		sendconfig(c);
+	}
+#endif
+}
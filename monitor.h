@@ -0,0 +1,20 @@
+/*
+ * Monitor layout for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ */
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <X11/Xlib.h>
+
+/* Function prototypes */
+void monitor_init(void);
+void monitor_update(ScreenInfo *s);
+Monitor *monitor_at(ScreenInfo *s, int x, int y);
+Monitor *monitor_of(Client *c);
+Monitor *monitor_pointer(ScreenInfo *s);
+Monitor *monitor_focused(ScreenInfo *s);
+void monitor_screenchange(XEvent *ev);
+
+#endif /* MONITOR_H */
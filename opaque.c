@@ -0,0 +1,237 @@
+/*
+ * Opaque move and resize for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ *
+ * With opaque_move set, sweepdrag() moves the real frame and client
+ * instead of an outline.  Geometry requests are queued here and sent
+ * on the client's pace: a client listing _NET_WM_SYNC_REQUEST gets a
+ * sync request before each resize, and the next resize waits until an
+ * alarm on its counter says it has painted the last one.  Other clients
+ * get at most one resize per OPAQUE_RATE_MS.  Plain moves are cheap
+ * for the client and are never held back.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/sync.h>
+#include "dat.h"
+#include "fns.h"
+
+/* Resize rate for clients without sync, and how long to wait for one with it */
+#define OPAQUE_RATE_MS		16
+#define OPAQUE_SYNC_TIMEOUT_MS	100
+
+int opaque_alarm_event = -1;
+
+static struct {
+	Client *c;
+	XSyncAlarm alarm;
+	XSyncValue value;           /* Last value asked of the counter */
+	int busy;                   /* Waiting for the client to reach value */
+	long sent;                  /* mstime() of the last resize sent */
+	int want;                   /* A geometry below is waiting to go out */
+	int x, y, dx, dy;
+	int cur_dx, cur_dy;         /* Size the client was last given */
+} op;
+
+int
+opaque_init(void)
+{
+	int error_base, major, minor;
+
+	if (!XSyncQueryExtension(dpy, &opaque_alarm_event, &error_base) ||
+	    !XSyncInitialize(dpy, &major, &minor)) {
+		fprintf(stderr, "opaque: XSync not available, resizes are rate limited\n");
+		opaque_alarm_event = -1;
+		return 0;
+	}
+	opaque_alarm_event += XSyncAlarmNotify;
+	return 1;
+}
+
+/* Put c's frame and window at x, y, dx, dy straight away, as reshape does */
+void
+opaque_apply(Client *c, int x, int y, int dx, int dy, int resize)
+{
+	if (!resize) {
+		XMoveWindow(dpy, c->parent, x - BORDER, y - BORDER);
+	} else {
+		XMoveResizeWindow(dpy, c->parent, x - BORDER, y - BORDER,
+		                  dx + 2 * (BORDER - 1), dy + 2 * (BORDER - 1));
+		XMoveResizeWindow(dpy, c->window, BORDER - 1, BORDER - 1, dx, dy);
+	}
+}
+
+static void
+opaque_sync_request(Client *c)
+{
+	XSyncValue one;
+	XEvent ev;
+	int overflow;
+
+	XSyncIntToValue(&one, 1);
+	XSyncValueAdd(&op.value, op.value, one, &overflow);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.xclient.type = ClientMessage;
+	ev.xclient.window = c->window;
+	ev.xclient.message_type = wm_protocols;
+	ev.xclient.format = 32;
+	ev.xclient.data.l[0] = net_wm_sync_request;
+	ev.xclient.data.l[1] = curtime;
+	ev.xclient.data.l[2] = XSyncValueLow32(op.value);
+	ev.xclient.data.l[3] = XSyncValueHigh32(op.value);
+	XSendEvent(dpy, c->window, False, 0L, &ev);
+}
+
+/* Send the waiting geometry if the client is ready for it */
+static void
+opaque_pump(void)
+{
+	XSyncAlarmAttributes attr;
+	Client *c;
+	long now;
+	int resize;
+
+	c = op.c;
+	if (c == 0 || !op.want)
+		return;
+	resize = op.dx != op.cur_dx || op.dy != op.cur_dy;
+	if (resize) {
+		now = mstime();
+		if (op.busy && now - op.sent < OPAQUE_SYNC_TIMEOUT_MS)
+			return;
+		if (op.alarm == None && now - op.sent < OPAQUE_RATE_MS)
+			return;
+		op.busy = 0;
+		op.sent = now;
+		if (op.alarm != None) {
+			opaque_sync_request(c);
+			attr.trigger.wait_value = op.value;
+			XSyncChangeAlarm(dpy, op.alarm, XSyncCAValue, &attr);
+			op.busy = 1;
+		}
+	}
+	opaque_apply(c, op.x, op.y, op.dx, op.dy, resize);
+	op.cur_dx = op.dx;
+	op.cur_dy = op.dy;
+	op.want = 0;
+	XFlush(dpy);
+}
+
+/* Start tracking c; its frame and window are where c says they are */
+void
+opaque_begin(Client *c)
+{
+	XSyncAlarmAttributes attr;
+
+	memset(&op, 0, sizeof(op));
+	op.c = c;
+	op.alarm = None;
+	op.cur_dx = c->dx;
+	op.cur_dy = c->dy;
+	if (opaque_alarm_event < 0 || !(c->proto & Psyncrequest) || c->sync_counter == None)
+		return;
+	if (!XSyncQueryCounter(dpy, c->sync_counter, &op.value))
+		return;
+	attr.trigger.counter = c->sync_counter;
+	attr.trigger.value_type = XSyncAbsolute;
+	attr.trigger.wait_value = op.value;
+	attr.trigger.test_type = XSyncPositiveComparison;
+	XSyncIntToValue(&attr.delta, 0);
+	attr.events = True;
+	op.alarm = XSyncCreateAlarm(dpy, XSyncCACounter | XSyncCAValueType | XSyncCAValue |
+	                            XSyncCATestType | XSyncCADelta | XSyncCAEvents, &attr);
+}
+
+/*
+ * Ask for the window to be at x, y, dx, dy (inside the border).  It
+ * goes out now, or once the client catches up or the rate allows.
+ */
+void
+opaque_moveresize(int x, int y, int dx, int dy)
+{
+	op.x = x;
+	op.y = y;
+	op.dx = dx;
+	op.dy = dy;
+	op.want = 1;
+	opaque_pump();
+}
+
+/*
+ * Like waitevent() with no window and no deadline, but meanwhile answer
+ * sync alarms and send held-back geometry when its time comes.
+ */
+void
+opaque_wait(XEvent *ev, long mask)
+{
+	struct timeval t, *tp;
+	XSyncAlarmNotifyEvent *a;
+	fd_set rfds;
+	long left;
+	int fd;
+
+	fd = ConnectionNumber(dpy);
+	for (;;) {
+		while (opaque_alarm_event >= 0 && XCheckTypedEvent(dpy, opaque_alarm_event, ev)) {
+			a = (XSyncAlarmNotifyEvent *) ev;
+			if (a->alarm == op.alarm && op.alarm != None)
+				op.busy = 0;
+		}
+		opaque_pump();
+		if (modalevent(None, ev, mask))
+			return;
+
+		tp = NULL;
+		if (op.want) {
+			left = op.sent + (op.busy ? OPAQUE_SYNC_TIMEOUT_MS : OPAQUE_RATE_MS) - mstime();
+			if (left < 1)
+				left = 1;
+			t.tv_sec = left / 1000;
+			t.tv_usec = (left % 1000) * 1000;
+			tp = &t;
+		}
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		if (select(fd + 1, &rfds, NULL, NULL, tp) < 0 && errno != EINTR) {
+			perror("9wm: opaque_wait: select failed");
+			XMaskEvent(dpy, mask, ev);
+			return;
+		}
+	}
+}
+
+/* Stop tracking; the caller puts the window at its final place */
+void
+opaque_end(void)
+{
+	if (op.alarm != None)
+		XSyncDestroyAlarm(dpy, op.alarm);
+	op.alarm = None;
+	op.c = 0;
+	op.want = 0;
+}
+
+/* Read the counter a client that takes sync requests will update */
+void
+opaque_getcounter(Client *c)
+{
+	long *p;
+
+	c->sync_counter = None;
+	if (!(c->proto & Psyncrequest))
+		return;
+	if (_getprop(c->window, net_wm_sync_request_counter, XA_CARDINAL, 1L, (unsigned char **) &p) <= 0)
+		return;
+	c->sync_counter = (XID) p[0];
+	XFree((char *) p);
+}
@@ -0,0 +1,158 @@
+/*
+ * Thumbnail scaling for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ *
+ * Each destination pixel is the average of the box of source pixels it
+ * covers.  Rows of a box are first summed per channel into acc[], then
+ * each run of acc[] is summed and divided.  On SSE2 both passes work on
+ * all four channels of a pixel at once.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "scale.h"
+
+static unsigned int *acc;
+static int acc_len;
+
+/* Source span [*a, *b) that destination pixel i of n covers */
+static void
+span(int i, int n, int len, int *a, int *b)
+{
+	*a = (int)((long) i * len / n);
+	*b = (int)((long) (i + 1) * len / n);
+	if (*b <= *a)
+		*b = *a + 1;
+	if (*b > len) {
+		*b = len;
+		*a = len - 1;
+	}
+}
+
+static int
+grow_acc(int sw)
+{
+	unsigned int *p;
+
+	if (sw <= acc_len)
+		return 1;
+	p = (unsigned int *) realloc(acc, sw * 4 * sizeof(unsigned int));
+	if (p == 0)
+		return 0;
+	acc = p;
+	acc_len = sw;
+	return 1;
+}
+
+void
+scale_box_generic(const unsigned int *src, int sw, int sh, int sstride,
+                  unsigned int *dst, int dw, int dh, int dstride)
+{
+	const unsigned int *row;
+	unsigned int *a, p, s0, s1, s2, s3, n, half;
+	int x, y, sx, sy, x0, x1, y0, y1;
+
+	if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0 || !grow_acc(sw))
+		return;
+
+	for (y = 0; y < dh; y++) {
+		span(y, dh, sh, &y0, &y1);
+		memset(acc, 0, sw * 4 * sizeof(unsigned int));
+		for (sy = y0; sy < y1; sy++) {
+			row = src + (long) sy * sstride;
+			for (x = 0, a = acc; x < sw; x++, a += 4) {
+				p = row[x];
+				a[0] += p & 0xff;
+				a[1] += (p >> 8) & 0xff;
+				a[2] += (p >> 16) & 0xff;
+				a[3] += p >> 24;
+			}
+		}
+		for (x = 0; x < dw; x++) {
+			span(x, dw, sw, &x0, &x1);
+			s0 = s1 = s2 = s3 = 0;
+			for (sx = x0, a = acc + 4 * x0; sx < x1; sx++, a += 4) {
+				s0 += a[0];
+				s1 += a[1];
+				s2 += a[2];
+				s3 += a[3];
+			}
+			n = (x1 - x0) * (y1 - y0);
+			half = n / 2;
+			dst[(long) y * dstride + x] = (s0 + half) / n | ((s1 + half) / n) << 8 |
+			                              ((s2 + half) / n) << 16 | ((s3 + half) / n) << 24;
+		}
+	}
+}
+
+#ifdef __SSE2__
+static void
+scale_box_sse2(const unsigned int *src, int sw, int sh, int sstride,
+               unsigned int *dst, int dw, int dh, int dstride)
+{
+	const unsigned int *row;
+	unsigned int *a, p;
+	__m128i zero, v, lo, hi, s;
+	__m128 r;
+	int x, y, sx, sy, x0, x1, y0, y1;
+
+	if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0 || !grow_acc(sw))
+		return;
+
+	zero = _mm_setzero_si128();
+	for (y = 0; y < dh; y++) {
+		span(y, dh, sh, &y0, &y1);
+		memset(acc, 0, sw * 4 * sizeof(unsigned int));
+		for (sy = y0; sy < y1; sy++) {
+			row = src + (long) sy * sstride;
+			/* Four pixels at a time, widened 8 -> 16 -> 32 bits */
+			for (x = 0, a = acc; x + 4 <= sw; x += 4, a += 16) {
+				v = _mm_loadu_si128((const __m128i *) (row + x));
+				lo = _mm_unpacklo_epi8(v, zero);
+				hi = _mm_unpackhi_epi8(v, zero);
+				_mm_storeu_si128((__m128i *) a, _mm_add_epi32(
+					_mm_loadu_si128((__m128i *) a), _mm_unpacklo_epi16(lo, zero)));
+				_mm_storeu_si128((__m128i *) (a + 4), _mm_add_epi32(
+					_mm_loadu_si128((__m128i *) (a + 4)), _mm_unpackhi_epi16(lo, zero)));
+				_mm_storeu_si128((__m128i *) (a + 8), _mm_add_epi32(
+					_mm_loadu_si128((__m128i *) (a + 8)), _mm_unpacklo_epi16(hi, zero)));
+				_mm_storeu_si128((__m128i *) (a + 12), _mm_add_epi32(
+					_mm_loadu_si128((__m128i *) (a + 12)), _mm_unpackhi_epi16(hi, zero)));
+			}
+			for (; x < sw; x++, a += 4) {
+				p = row[x];
+				a[0] += p & 0xff;
+				a[1] += (p >> 8) & 0xff;
+				a[2] += (p >> 16) & 0xff;
+				a[3] += p >> 24;
+			}
+		}
+		for (x = 0; x < dw; x++) {
+			span(x, dw, sw, &x0, &x1);
+			s = zero;
+			for (sx = x0, a = acc + 4 * x0; sx < x1; sx++, a += 4)
+				s = _mm_add_epi32(s, _mm_loadu_si128((__m128i *) a));
+			r = _mm_mul_ps(_mm_cvtepi32_ps(s),
+			               _mm_set1_ps(1.0f / ((x1 - x0) * (y1 - y0))));
+			s = _mm_cvtps_epi32(r);
+			s = _mm_packs_epi32(s, s);
+			s = _mm_packus_epi16(s, s);
+			dst[(long) y * dstride + x] = (unsigned int) _mm_cvtsi128_si32(s);
+		}
+	}
+}
+#endif
+
+void
+scale_box(const unsigned int *src, int sw, int sh, int sstride,
+          unsigned int *dst, int dw, int dh, int dstride)
+{
+#ifdef __SSE2__
+	scale_box_sse2(src, sw, sh, sstride, dst, dw, dh, dstride);
+#else
+	scale_box_generic(src, sw, sh, sstride, dst, dw, dh, dstride);
+#endif
+}
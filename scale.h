@@ -0,0 +1,18 @@
+/*
+ * Thumbnail scaling for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ */
+
+#ifndef SCALE_H
+#define SCALE_H
+
+/*
+ * Box-filter src (sw x sh) into dst (dw x dh).  Pixels are 32 bits
+ * with four 8 bit channels; strides are in pixels, not bytes.
+ */
+void scale_box(const unsigned int *src, int sw, int sh, int sstride,
+               unsigned int *dst, int dw, int dh, int dstride);
+void scale_box_generic(const unsigned int *src, int sw, int sh, int sstride,
+                       unsigned int *dst, int dw, int dh, int dstride);
+
+#endif /* SCALE_H */
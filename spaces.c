@@ -15,172 +15,626 @@
 #include "workspace.h"
 #include "config.h"
 #include "spaces.h"
+#include "thumb.h"
+#include "monitor.h"
 
-SpacesView spaces_view = {0};
+/* The view of the screen spaces is open on, or was last used on */
+SpacesView *spaces_view;
 
+static void
+spaces_cell_origin(int ws, int *x, int *y)
+{
+	*x = spaces_view->cell[ws].x;
+	*y = spaces_view->cell[ws].y;
+}
+
+/*
+ * Thumbnail rectangle for c inside the cell at ws_x, ws_y, both as laid
+ * out (r) and clipped to the cell's content area (clip).
+ */
+static int
+spaces_thumb_rects(Client *c, int ws_x, int ws_y, int ws_width, int ws_height, XRectangle *r, XRectangle *clip)
+{
+	int thumb_x, thumb_y, thumb_width, thumb_height;
+	int content_x, content_y, content_width, content_height;
+	int x1, y1, x2, y2;
+	
+	/* Use content area of workspace (exclude label area) */
+	content_x = ws_x + 2;
+	content_y = ws_y + spaces_view->content_top;
+	content_width = ws_width - 4;
+	content_height = ws_height - spaces_view->content_top - 2;
+	
+	/* Ensure content area is valid */
+	if (content_width <= 0 || content_height <= 0)
+		return 0;
+	
+	/* Calculate thumbnail position and size */
+	thumb_x = content_x + (int)(c->x * spaces_view->scale_x);
+	thumb_y = content_y + (int)(c->y * spaces_view->scale_y);
+	thumb_width = (int)(c->dx * spaces_view->scale_x);
+	thumb_height = (int)(c->dy * spaces_view->scale_y);
+	
+	/* Minimum size for visibility */
+	if (thumb_width < 2) thumb_width = 2;
+	if (thumb_height < 2) thumb_height = 2;
+	
+	/* Clip to content area */
+	x1 = thumb_x < content_x ? content_x : thumb_x;
+	y1 = thumb_y < content_y ? content_y : thumb_y;
+	x2 = thumb_x + thumb_width;
+	y2 = thumb_y + thumb_height;
+	if (x2 > content_x + content_width)
+		x2 = content_x + content_width;
+	if (y2 > content_y + content_height)
+		y2 = content_y + content_height;
+	
+	/* Only draw if thumbnail is valid */
+	if (x2 <= x1 || y2 <= y1)
+		return 0;
+	
+	r->x = thumb_x;
+	r->y = thumb_y;
+	r->width = thumb_width;
+	r->height = thumb_height;
+	clip->x = x1;
+	clip->y = y1;
+	clip->width = x2 - x1;
+	clip->height = y2 - y1;
+	return 1;
+}
+
+/* Each screen has its own view: overlay, back buffer and cell cache */
 void
 spaces_init(ScreenInfo *s)
 {
-	spaces_view.screen = s;
-	spaces_view.active = 0;
-	spaces_view.selected_workspace = current_workspace;
-	spaces_view.drag_active = 0;
-	spaces_view.drag_client = NULL;
-	spaces_view.overlay = None;
+	SpacesView *v;
+	
+	v = (SpacesView *) calloc(1, sizeof(SpacesView));
+	if (v == 0)
+		fatal("spaces_init");
+	v->screen = s;
+	v->active = 0;
+	v->selected_workspace = current_workspace;
+	v->drag_active = 0;
+	v->drag_client = NULL;
+	v->overlay = None;
+	v->buffer = None;
+	v->ndirty = 0;
+	s->spaces = v;
+	if (spaces_view == 0)
+		spaces_view = v;
 }
 
-void
-spaces_show(ScreenInfo *s)
+/* The workspace on the head the overlay covers */
+static int
+spaces_current(void)
+{
+	return monitor_at(spaces_view->screen, spaces_view->x, spaces_view->y)->workspace;
+}
+
+/*
+ * Fit workspace_count cells into a roughly square grid.  When that would
+ * make cells smaller than SPACES_MIN_CELL_WIDTH x SPACES_MIN_CELL_HEIGHT,
+ * only visible_rows rows are shown and the rest are reached by scrolling.
+ */
+static void
+spaces_layout(int width, int height)
+{
+	int n, avail_w, avail_h, max_cols, max_rows;
+	
+	n = workspace_count > 0 ? workspace_count : 1;
+	spaces_view->margin = width * 0.1; /* 10% margin */
+	avail_w = width - 2 * spaces_view->margin;
+	avail_h = height - 2 * spaces_view->margin;
+	max_cols = avail_w / SPACES_MIN_CELL_WIDTH;
+	max_rows = avail_h / SPACES_MIN_CELL_HEIGHT;
+	if (max_cols < 1) max_cols = 1;
+	if (max_rows < 1) max_rows = 1;
+	
+	for (spaces_view->cols = 1; spaces_view->cols * spaces_view->cols < n; spaces_view->cols++)
+		;
+	if (spaces_view->cols > max_cols)
+		spaces_view->cols = max_cols;
+	spaces_view->rows = (n + spaces_view->cols - 1) / spaces_view->cols;
+	spaces_view->visible_rows = spaces_view->rows < max_rows ? spaces_view->rows : max_rows;
+	spaces_view->first_row = 0;
+	
+	spaces_view->grid_x = avail_w / spaces_view->cols;
+	spaces_view->grid_y = avail_h / spaces_view->visible_rows;
+	spaces_view->cell_width = spaces_view->grid_x - 20; /* Small gap between cells */
+	spaces_view->cell_height = spaces_view->grid_y - 20;
+	
+	/* Thumbnails still show the whole screen, every head of it */
+	spaces_view->content_top = font ? font->ascent + font->descent + 10 : 20;
+	spaces_view->scale_x = (double)(spaces_view->cell_width - 4) /
+		DisplayWidth(dpy, spaces_view->screen->num);
+	spaces_view->scale_y = (double)(spaces_view->cell_height - spaces_view->content_top - 2) /
+		DisplayHeight(dpy, spaces_view->screen->num);
+}
+
+/* Range of workspaces in the visible rows, as [*first, *last) */
+static void
+spaces_visible_range(int *first, int *last)
+{
+	*first = spaces_view->first_row * spaces_view->cols;
+	*last = (spaces_view->first_row + spaces_view->visible_rows) * spaces_view->cols;
+	if (*last > workspace_count)
+		*last = workspace_count;
+}
+
+static int
+spaces_visible(int ws)
+{
+	int first, last;
+	
+	spaces_visible_range(&first, &last);
+	return ws >= first && ws < last;
+}
+
+static void
+spaces_mark(int ws)
+{
+	if (spaces_visible(ws) && !spaces_view->dirty[ws]) {
+		spaces_view->dirty[ws] = 1;
+		spaces_view->ndirty++;
+	}
+}
+
+/* Everything the hit tests need, so motion events never redo this */
+static void
+spaces_place_cells(void)
+{
+	int ws, first, last, slot;
+	
+	spaces_visible_range(&first, &last);
+	for (ws = first; ws < last; ws++) {
+		slot = ws - first;
+		spaces_view->cell[ws].x = spaces_view->margin + (slot % spaces_view->cols) * spaces_view->grid_x + 10;
+		spaces_view->cell[ws].y = spaces_view->margin + (slot / spaces_view->cols) * spaces_view->grid_y + 10;
+		spaces_view->cell[ws].width = spaces_view->cell_width;
+		spaces_view->cell[ws].height = spaces_view->cell_height;
+	}
+}
+
+/*
+ * Make s's view the current one and give it an overlay, back buffer and
+ * grid layout on the focused monitor.  These live until spaces is asked
+ * for on another head of s; hiding only unmaps.
+ */
+static void
+spaces_setup(ScreenInfo *s)
 {
 	XSetWindowAttributes attr;
-	int screen_width, screen_height;
+	Monitor *m;
 	
-	if (spaces_view.active)
+	spaces_view = s->spaces;
+	m = monitor_focused(s);
+	if (spaces_view->overlay != None &&
+	    spaces_view->x == m->x && spaces_view->y == m->y &&
+	    spaces_view->width == m->width && spaces_view->height == m->height)
 		return;
-		
-	screen_width = DisplayWidth(dpy, s->num);
-	screen_height = DisplayHeight(dpy, s->num);
+	if (spaces_view->overlay != None) {
+		XFreePixmap(dpy, spaces_view->buffer);
+		XDestroyWindow(dpy, spaces_view->overlay);
+	}
+	spaces_view->x = m->x;
+	spaces_view->y = m->y;
+	spaces_view->width = m->width;
+	spaces_view->height = m->height;
 	
-	/* Calculate grid layout */
-	spaces_view.margin = screen_width * 0.1; /* 10% margin */
-	spaces_view.grid_x = (screen_width - 2 * spaces_view.margin) / SPACES_GRID_SIZE;
-	spaces_view.grid_y = (screen_height - 2 * spaces_view.margin) / SPACES_GRID_SIZE;
-	spaces_view.cell_width = spaces_view.grid_x - 20; /* Small gap between cells */
-	spaces_view.cell_height = spaces_view.grid_y - 20;
+	spaces_layout(spaces_view->width, spaces_view->height);
 	
 	/* Create overlay window */
 	attr.override_redirect = True;
-	attr.background_pixel = s->menu_bg;  /* Use menu background color */
+	attr.background_pixmap = None;       /* Contents always come from the buffer */
 	attr.border_pixel = s->menu_fg;      /* Use menu foreground color for border */
 	attr.event_mask = ExposureMask | ButtonPressMask | ButtonReleaseMask | 
 	                  PointerMotionMask | KeyPressMask;
 	
-	spaces_view.overlay = XCreateWindow(dpy, s->root, 0, 0, 
-	                                   screen_width, screen_height, 1,
+	spaces_view->overlay = XCreateWindow(dpy, s->root, spaces_view->x, spaces_view->y,
+	                                   spaces_view->width, spaces_view->height, 1,
 	                                   CopyFromParent, InputOutput, CopyFromParent,
-	                                   CWOverrideRedirect | CWBackPixel | CWBorderPixel | CWEventMask,
+	                                   CWOverrideRedirect | CWBackPixmap | CWBorderPixel | CWEventMask,
 	                                   &attr);
 	
-	XMapRaised(dpy, spaces_view.overlay);
-	XGrabKeyboard(dpy, spaces_view.overlay, True, GrabModeAsync, GrabModeAsync, CurrentTime);
-	XSetInputFocus(dpy, spaces_view.overlay, RevertToParent, CurrentTime);
+	/*
+	 * Everything is drawn into this pixmap first; the overlay only ever
+	 * gets copies, so a repaint never shows a half-cleared screen.
+	 */
+	spaces_view->buffer = XCreatePixmap(dpy, spaces_view->overlay, spaces_view->width, spaces_view->height,
+	                                   DefaultDepth(dpy, s->num));
+	spaces_draw();
+}
+
+void
+spaces_show(ScreenInfo *s)
+{
+	Client *c;
+	int i;
+#ifdef	DEBUG
+	long start = mstime();
+#endif
+	
+	/* One overview at a time: it holds the keyboard */
+	if (spaces_view->active)
+		return;
+	
+	/* Normally a no-op: the idle pre-render already brought the buffer up to date */
+	spaces_setup(s);
+	/* The overlay is on the focused head; switches from it act there */
+	current_workspace = spaces_current();
+	spaces_scroll(0);
+	/* Without Composite, the last chance to see the windows is before we cover them */
+	if (thumb_capture(s)) {
+		for (i = 0; i < s->nmonitors; i++)
+			spaces_mark(s->monitors[i].workspace);
+	}
+	spaces_prerender();
+	
+	/* Watch visible clients so their thumbnails can follow their contents */
+	if (thumb_enabled) {
+		for (c = clients; c; c = c->next) {
+			if (normal(c) && c->screen == s && workspace_shown(c))
+				thumb_track(c);
+		}
+	}
+	spaces_view->refresh_pending = thumb_enabled;
+	spaces_view->last_refresh = 0;
+	spaces_view->selected_workspace = current_workspace;
+	
+	XMapRaised(dpy, spaces_view->overlay);
+	XGrabKeyboard(dpy, spaces_view->overlay, True, GrabModeAsync, GrabModeAsync, CurrentTime);
+	XSetInputFocus(dpy, spaces_view->overlay, RevertToParent, CurrentTime);
 	
-	spaces_view.active = 1;
+	spaces_view->active = 1;
 	spaces_mode = 1;
 	
-	spaces_draw();
+	XCopyArea(dpy, spaces_view->buffer, spaces_view->overlay, spaces_view->screen->copy_gc, 0, 0,
+	          spaces_view->width, spaces_view->height, 0, 0);
+#ifdef	DEBUG
+	XSync(dpy, False);
+	fprintf(stderr, "spaces: open to first frame %ld ms\n", mstime() - start);
+#endif
 }
 
 void
 spaces_hide(void)
 {
-	if (!spaces_view.active)
+	Client *c;
+	
+	if (!spaces_view->active)
 		return;
 		
 	/* Ungrab everything first */
 	XUngrabKeyboard(dpy, CurrentTime);
 	XUngrabPointer(dpy, CurrentTime);
 	
-	/* Unmap and destroy the overlay window */
-	if (spaces_view.overlay != None) {
-		XUnmapWindow(dpy, spaces_view.overlay);
-		XDestroyWindow(dpy, spaces_view.overlay);
-		spaces_view.overlay = None;
+	/* Damage tracking only lives as long as the overlay is up */
+	for (c = clients; c; c = c->next)
+		thumb_untrack(c);
+	thumb_capture_end();
+	spaces_view->refresh_pending = 0;
+#ifdef	DEBUG
+	{
+		ThumbCacheStats st;
+		
+		thumb_cache_stats(&st);
+		fprintf(stderr, "spaces: thumbnail cache %d entries, %lu bytes, %lu hits, %lu misses, %lu evictions\n",
+		        st.entries, st.bytes, st.hits, st.misses, st.evictions);
 	}
+#endif
+	
+	/* Keep the overlay and buffer around for next time */
+	XUnmapWindow(dpy, spaces_view->overlay);
 	
 	/* Reset all state */
-	spaces_view.active = 0;
+	spaces_view->active = 0;
 	spaces_mode = 0;
-	spaces_view.drag_active = 0;
-	spaces_view.drag_client = NULL;
-	spaces_view.selected_workspace = current_workspace;
-	
-	/* Ensure X server is synchronized first */
-	XSync(dpy, False);
-	XFlush(dpy);
+	spaces_view->drag_active = 0;
+	spaces_view->drag_client = NULL;
+	spaces_view->selected_workspace = current_workspace;
 	
-	/* Restore proper focus after sync */
+	/* Restore proper focus */
 	if (current && current->screen) {
 		active(current);
 	}
 }
 
+/*
+ * Cheap summary of everything spaces_draw_workspace() looks at for ws,
+ * so idle pre-rendering can tell which cells went stale.
+ */
+static unsigned long
+spaces_cell_signature(int ws)
+{
+	Client *c;
+	unsigned long sig;
+	
+	sig = (ws == spaces_current()) | (ws < workspace_count) << 1 |
+	      (spaces_view->drag_active && ws == spaces_view->selected_workspace) << 2;
+	if (ws >= workspace_count)
+		return sig;
+	for (c = workspaces[ws].clients; c; c = c->workspace_next) {
+		if (!normal(c) || c->screen != spaces_view->screen)
+			continue;
+		if (spaces_view->drag_active && c == spaces_view->drag_client && 
+		    ws == spaces_view->drag_start_ws)
+			continue;
+		sig = sig * 31 + c->x;
+		sig = sig * 31 + c->y;
+		sig = sig * 31 + c->dx;
+		sig = sig * 31 + c->dy;
+	}
+	return sig;
+}
+
+/*
+ * Paint one cell into the back buffer, including the gap around it
+ * that the thick current/drag-target borders reach into.
+ */
+static void
+spaces_paint_cell(int ws)
+{
+	int x, y;
+	
+	spaces_cell_origin(ws, &x, &y);
+	spaces_view->sig[ws] = spaces_cell_signature(ws);
+	XSetForeground(dpy, spaces_view->screen->copy_gc, spaces_view->screen->menu_bg);
+	XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
+	               x - 3, y - 3, spaces_view->cell_width + 6, spaces_view->cell_height + 6);
+	spaces_draw_workspace(ws, x, y, spaces_view->cell_width, spaces_view->cell_height);
+}
+
+static void
+spaces_copy_cell(int ws)
+{
+	int x, y;
+	
+	spaces_cell_origin(ws, &x, &y);
+	XCopyArea(dpy, spaces_view->buffer, spaces_view->overlay, spaces_view->screen->copy_gc,
+	          x - 3, y - 3, spaces_view->cell_width + 6, spaces_view->cell_height + 6,
+	          x - 3, y - 3);
+}
+
 void
 spaces_draw(void)
 {
-	int i, j, ws, x, y;
+	int ws, first, last, x, y, h;
+#ifdef	DEBUG
+	unsigned long req = NextRequest(dpy);
+#endif
 	
-	if (!spaces_view.active)
+	if (spaces_view->buffer == None)
 		return;
 		
-	XClearWindow(dpy, spaces_view.overlay);
-	
-	
-	/* Always draw 9 workspace boxes in 3x3 grid */
-	ws = 0;
-	for (i = 0; i < SPACES_GRID_SIZE; i++) {
-		for (j = 0; j < SPACES_GRID_SIZE; j++) {
-			x = spaces_view.margin + j * spaces_view.grid_x + 10;
-			y = spaces_view.margin + i * spaces_view.grid_y + 10;
-			
-			/* Draw workspace box even if workspace doesn't exist */
-			spaces_draw_workspace(ws, x, y, spaces_view.cell_width, spaces_view.cell_height);
-			ws++;
-		}
+	XSetForeground(dpy, spaces_view->screen->copy_gc, spaces_view->screen->menu_bg);
+	XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 0, 0,
+	               spaces_view->width, spaces_view->height);
+	
+	/* Only the rows on screen; the rest cost nothing until scrolled to */
+	spaces_place_cells();
+	spaces_visible_range(&first, &last);
+	for (ws = first; ws < last; ws++)
+		spaces_paint_cell(ws);
+	
+	/* Scroll bar in the right margin when not everything fits */
+	if (spaces_view->rows > spaces_view->visible_rows) {
+		x = spaces_view->width - spaces_view->margin + 10;
+		y = spaces_view->margin + 10;
+		h = spaces_view->visible_rows * spaces_view->grid_y - 20;
+		XSetForeground(dpy, spaces_view->screen->copy_gc, spaces_view->screen->menu_fg);
+		XDrawRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, x, y, 6, h);
+		XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, x,
+		               y + h * spaces_view->first_row / spaces_view->rows, 7,
+		               h * spaces_view->visible_rows / spaces_view->rows);
 	}
 	
+	if (spaces_view->active)
+		XCopyArea(dpy, spaces_view->buffer, spaces_view->overlay, spaces_view->screen->copy_gc, 0, 0,
+		          spaces_view->width, spaces_view->height, 0, 0);
+	memset(spaces_view->dirty, 0, sizeof(spaces_view->dirty));
+	spaces_view->ndirty = 0;
 	
+#ifdef	DEBUG
+	fprintf(stderr, "spaces: full redraw, %lu requests\n", NextRequest(dpy) - req);
+#endif
 	XFlush(dpy);
 }
 
+/*
+ * Repaint only the cells marked in spaces_view->dirty and copy just
+ * those cells to the overlay.
+ */
+void
+spaces_draw_cells(void)
+{
+	int ws, first, last;
+#ifdef	DEBUG
+	unsigned long req = NextRequest(dpy);
+	int n = 0;
+#endif
+	
+	if (spaces_view->buffer == None || !spaces_view->ndirty)
+		return;
+	
+	spaces_visible_range(&first, &last);
+	for (ws = first; ws < last; ws++) {
+		if (!spaces_view->dirty[ws])
+			continue;
+		spaces_view->dirty[ws] = 0;
+		spaces_paint_cell(ws);
+		if (spaces_view->active)
+			spaces_copy_cell(ws);
+#ifdef	DEBUG
+		n++;
+#endif
+	}
+	spaces_view->ndirty = 0;
+	
+#ifdef	DEBUG
+	fprintf(stderr, "spaces: redrew %d cells, %lu requests\n", n, NextRequest(dpy) - req);
+#endif
+	XFlush(dpy);
+}
+
+static void
+spaces_prerender_view(void)
+{
+	int ws, first, last;
+	
+	if (spaces_view->buffer == None) {
+		spaces_setup(spaces_view->screen);
+		return;
+	}
+	if (spaces_view->drag_active)
+		return;
+	spaces_visible_range(&first, &last);
+	for (ws = first; ws < last; ws++) {
+		if (spaces_cell_signature(ws) != spaces_view->sig[ws])
+			spaces_mark(ws);
+	}
+	spaces_draw_cells();
+}
+
+/*
+ * Called whenever the event queue runs dry: repaint any cell whose
+ * contents changed since it was last painted, on every screen, so that
+ * spaces_show() only has to map the overlay and copy the buffer.  While
+ * spaces is open only its own screen is kept up.
+ */
+void
+spaces_prerender(void)
+{
+	SpacesView *v;
+	int i;
+	
+	if (spaces_view == 0)
+		return;
+	if (spaces_view->active) {
+		spaces_prerender_view();
+		return;
+	}
+	v = spaces_view;
+	for (i = 0; i < num_screens; i++) {
+		spaces_view = screens[i].spaces;
+		spaces_prerender_view();
+	}
+	spaces_view = v;
+}
+
+/*
+ * Colours or font changed.  Hidden overlays are dropped, to be made
+ * again by the next pre-render; an open one is just redrawn.
+ */
+void
+spaces_reset(void)
+{
+	SpacesView *v;
+	int i;
+	
+	v = spaces_view;
+	for (i = 0; i < num_screens; i++) {
+		spaces_view = screens[i].spaces;
+		if (spaces_view->active)
+			spaces_draw();
+		else if (spaces_view->overlay != None) {
+			XFreePixmap(dpy, spaces_view->buffer);
+			XDestroyWindow(dpy, spaces_view->overlay);
+			spaces_view->overlay = None;
+			spaces_view->buffer = None;
+		}
+	}
+	spaces_view = v;
+}
+
+/*
+ * Scroll the grid by rows (negative is up).  Zero just makes sure the
+ * current workspace is on screen, as when spaces is opened.
+ */
+void
+spaces_scroll(int rows)
+{
+	int first_row, max_row, ws;
+	
+	if (spaces_view->buffer == None)
+		return;
+	first_row = spaces_view->first_row + rows;
+	if (rows == 0) {
+		ws = spaces_current();
+		if (ws / spaces_view->cols < first_row)
+			first_row = ws / spaces_view->cols;
+		else if (ws / spaces_view->cols >= first_row + spaces_view->visible_rows)
+			first_row = ws / spaces_view->cols - spaces_view->visible_rows + 1;
+	}
+	max_row = spaces_view->rows - spaces_view->visible_rows;
+	if (first_row > max_row) first_row = max_row;
+	if (first_row < 0) first_row = 0;
+	if (first_row == spaces_view->first_row)
+		return;
+	
+	spaces_view->first_row = first_row;
+	spaces_draw();
+}
+
+void
+spaces_expose(XExposeEvent *e)
+{
+	/* The buffer is always current, so exposures are just copies */
+	if (!spaces_view->active)
+		return;
+	XCopyArea(dpy, spaces_view->buffer, spaces_view->overlay, spaces_view->screen->copy_gc,
+	          e->x, e->y, e->width, e->height, e->x, e->y);
+}
+
 void
 spaces_draw_workspace(int ws, int x, int y, int width, int height)
 {
 	Client *c;
 	char label[16];
 	int label_x, label_y;
-	int is_current = (ws == current_workspace);
+	int is_current = (ws == spaces_current());
 	int is_valid = (ws < workspace_count);
-	int is_drag_target = (spaces_view.drag_active && ws == spaces_view.selected_workspace);
+	int is_drag_target = (spaces_view->drag_active && ws == spaces_view->selected_workspace);
 	unsigned long bg_color, fg_color, border_color;
 	
 	/* Use menu colors instead of one color and its inverse */
-	bg_color = spaces_view.screen->menu_bg;  /* Menu background - brown */
-	fg_color = spaces_view.screen->menu_fg;  /* Menu foreground - cream */
-	border_color = spaces_view.screen->menu_fg; /* Use menu foreground for borders too */
+	bg_color = spaces_view->screen->menu_bg;  /* Menu background - brown */
+	fg_color = spaces_view->screen->menu_fg;  /* Menu foreground - cream */
+	border_color = spaces_view->screen->menu_fg; /* Use menu foreground for borders too */
 	
 	/* Always draw the box outline */
 	if (is_current && is_valid) {
 		/* Current workspace - draw thick border with background interior */
-		XSetForeground(dpy, spaces_view.screen->gc, border_color);
-		XFillRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, border_color);
+		XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x - 2, y - 2, width + 4, height + 4);
-		XSetForeground(dpy, spaces_view.screen->gc, bg_color);
-		XFillRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, bg_color);
+		XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x, y, width, height);
 	} else if (is_drag_target && is_valid) {
 		/* Drag target - highlight border using menu foreground */
-		XSetForeground(dpy, spaces_view.screen->gc, border_color);
-		XFillRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, border_color);
+		XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x - 3, y - 3, width + 6, height + 6);
-		XSetForeground(dpy, spaces_view.screen->gc, bg_color);
-		XFillRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, bg_color);
+		XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x, y, width, height);
 	} else if (is_valid) {
 		/* Valid workspace - background interior with foreground border */
-		XSetForeground(dpy, spaces_view.screen->gc, bg_color);
-		XFillRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, bg_color);
+		XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x, y, width, height);
-		XSetForeground(dpy, spaces_view.screen->gc, fg_color);
-		XDrawRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, fg_color);
+		XDrawRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x, y, width - 1, height - 1);
 	} else {
 		/* Invalid workspace - use menu colors for consistency */
-		XSetForeground(dpy, spaces_view.screen->gc, bg_color);
-		XFillRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, bg_color);
+		XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x, y, width, height);
-		XSetForeground(dpy, spaces_view.screen->gc, fg_color);
-		XDrawRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
+		XSetForeground(dpy, spaces_view->screen->copy_gc, fg_color);
+		XDrawRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
 		               x, y, width - 1, height - 1);
 	}
 	
@@ -193,29 +647,29 @@ spaces_draw_workspace(int ws, int x, int y, int width, int height)
 		/* Use appropriate color for label based on background */
 		if (is_current && is_valid) {
 			/* Use foreground color on background for current workspace */
-			XSetForeground(dpy, spaces_view.screen->text_gc, fg_color);
+			XSetForeground(dpy, spaces_view->screen->text_gc, fg_color);
 		} else if (is_valid) {
 			/* Use foreground color for valid workspaces */
-			XSetForeground(dpy, spaces_view.screen->text_gc, fg_color);
+			XSetForeground(dpy, spaces_view->screen->text_gc, fg_color);
 		} else {
 			/* Use contrasting color for invalid workspaces */
-			XSetForeground(dpy, spaces_view.screen->text_gc, bg_color);
+			XSetForeground(dpy, spaces_view->screen->text_gc, bg_color);
 		}
 		
-		XDrawString(dpy, spaces_view.overlay, spaces_view.screen->text_gc, 
+		XDrawString(dpy, spaces_view->buffer, spaces_view->screen->text_gc, 
 		           label_x, label_y, label, strlen(label));
 		
 		/* Reset to foreground color */
-		XSetForeground(dpy, spaces_view.screen->text_gc, fg_color);
+		XSetForeground(dpy, spaces_view->screen->text_gc, fg_color);
 	}
 	
 	/* Draw window thumbnails only for valid workspaces */
 	if (is_valid) {
 		for (c = workspaces[ws].clients; c; c = c->workspace_next) {
-			if (normal(c)) {
+			if (normal(c) && c->screen == spaces_view->screen) {
 				/* Skip drawing the window being dragged in its original location */
-				if (spaces_view.drag_active && c == spaces_view.drag_client && 
-				    ws == spaces_view.drag_start_ws) {
+				if (spaces_view->drag_active && c == spaces_view->drag_client && 
+				    ws == spaces_view->drag_start_ws) {
 					continue;
 				}
 				spaces_draw_window_thumbnail(c, x, y, width, height);
@@ -227,95 +681,130 @@ spaces_draw_workspace(int ws, int x, int y, int width, int height)
 void
 spaces_draw_window_thumbnail(Client *c, int ws_x, int ws_y, int ws_width, int ws_height)
 {
-	int screen_width, screen_height;
-	int thumb_x, thumb_y, thumb_width, thumb_height;
-	double scale_x, scale_y;
-	int content_x, content_y, content_width, content_height;
-	
-	screen_width = DisplayWidth(dpy, spaces_view.screen->num);
-	screen_height = DisplayHeight(dpy, spaces_view.screen->num);
+	XRectangle r, clip;
 	
-	/* Use content area of workspace (exclude label area) */
-	content_x = ws_x + 2;
-	content_y = ws_y + (font ? font->ascent + font->descent + 10 : 20);
-	content_width = ws_width - 4;
-	content_height = ws_height - (content_y - ws_y) - 2;
+	if (!spaces_thumb_rects(c, ws_x, ws_y, ws_width, ws_height, &r, &clip)) {
+		c->thumb_rect.width = c->thumb_rect.height = 0;
+		return;
+	}
+	c->thumb_rect = r;
 	
-	/* Ensure content area is valid */
-	if (content_width <= 0 || content_height <= 0)
+	/* Live contents when we have them, otherwise a filled rectangle in menu foreground */
+	if (thumb_draw(c, spaces_view->buffer, &r, &clip))
 		return;
+	XSetForeground(dpy, spaces_view->screen->copy_gc, spaces_view->screen->menu_fg);
+	XFillRectangle(dpy, spaces_view->buffer, spaces_view->screen->copy_gc, 
+	               clip.x, clip.y, clip.width, clip.height);
+}
+
+void
+spaces_damage(XEvent *ev)
+{
+	Client *c;
 	
-	/* Calculate scaling factors based on content area */
-	scale_x = (double)content_width / screen_width;
-	scale_y = (double)content_height / screen_height;
+	c = thumb_handle_damage(ev);
+	if (c == 0 || !spaces_view->active)
+		return;
 	
-	/* Calculate thumbnail position and size */
-	thumb_x = content_x + (int)(c->x * scale_x);
-	thumb_y = content_y + (int)(c->y * scale_y);
-	thumb_width = (int)(c->dx * scale_x);
-	thumb_height = (int)(c->dy * scale_y);
+	/* Repaint right away unless we refreshed recently; the rest waits for the timer */
+	spaces_view->refresh_pending = 1;
+	if (mstime() - spaces_view->last_refresh >= config.spaces_refresh_ms)
+		spaces_refresh();
+}
+
+/*
+ * Repaint the thumbnails that were damaged since the last refresh.
+ * Thumbnails drawn after a damaged one in the same cell are repainted
+ * too where they overlap it, so stacking matches spaces_draw().
+ */
+void
+spaces_refresh(void)
+{
+	Client *c;
+	XRectangle r, clip, done;
+	int ws, first, last, x, y, dirty;
 	
-	/* Minimum size for visibility */
-	if (thumb_width < 2) thumb_width = 2;
-	if (thumb_height < 2) thumb_height = 2;
+	if (!spaces_view->active || !spaces_view->refresh_pending)
+		return;
 	
-	/* Clip to content area */
-	if (thumb_x < content_x) {
-		thumb_width -= (content_x - thumb_x);
-		thumb_x = content_x;
-	}
-	if (thumb_y < content_y) {
-		thumb_height -= (content_y - thumb_y);
-		thumb_y = content_y;
+	spaces_visible_range(&first, &last);
+	for (ws = first; ws < last; ws++) {
+		spaces_cell_origin(ws, &x, &y);
+		dirty = 0;
+		for (c = workspaces[ws].clients; c; c = c->workspace_next) {
+			if (!normal(c) || c->screen != spaces_view->screen)
+				continue;
+			if (spaces_view->drag_active && c == spaces_view->drag_client && 
+			    ws == spaces_view->drag_start_ws)
+				continue;
+			if (!spaces_thumb_rects(c, x, y, spaces_view->cell_width, spaces_view->cell_height, &r, &clip))
+				continue;
+			if (!c->thumb_dirty) {
+				if (!dirty || clip.x >= done.x + done.width || done.x >= clip.x + clip.width ||
+				    clip.y >= done.y + done.height || done.y >= clip.y + clip.height)
+					continue;
+			}
+			spaces_draw_window_thumbnail(c, x, y, spaces_view->cell_width, spaces_view->cell_height);
+			c->thumb_dirty = 0;
+			if (!dirty) {
+				done = clip;
+				dirty = 1;
+			} else {
+				/* Grow the repainted area to cover this thumbnail too */
+				int x2 = done.x + done.width, y2 = done.y + done.height;
+				if (clip.x + clip.width > x2) x2 = clip.x + clip.width;
+				if (clip.y + clip.height > y2) y2 = clip.y + clip.height;
+				if (clip.x < done.x) done.x = clip.x;
+				if (clip.y < done.y) done.y = clip.y;
+				done.width = x2 - done.x;
+				done.height = y2 - done.y;
+			}
+		}
+		if (dirty)
+			XCopyArea(dpy, spaces_view->buffer, spaces_view->overlay, spaces_view->screen->copy_gc,
+			          done.x, done.y, done.width, done.height, done.x, done.y);
 	}
-	if (thumb_x + thumb_width > content_x + content_width)
-		thumb_width = content_x + content_width - thumb_x;
-	if (thumb_y + thumb_height > content_y + content_height)
-		thumb_height = content_y + content_height - thumb_y;
 	
-	/* Only draw if thumbnail is valid */
-	if (thumb_width > 0 && thumb_height > 0) {
-		/* Draw filled rectangle for window using menu foreground color */
-		XSetForeground(dpy, spaces_view.screen->gc, spaces_view.screen->menu_fg);
-		XFillRectangle(dpy, spaces_view.overlay, spaces_view.screen->gc, 
-		               thumb_x, thumb_y, thumb_width, thumb_height);
-	}
+	spaces_view->refresh_pending = 0;
+	spaces_view->last_refresh = mstime();
+	XFlush(dpy);
+}
+
+int
+spaces_refresh_timeout(void)
+{
+	long wait;
+	
+	if (!spaces_view->active || !spaces_view->refresh_pending)
+		return -1;
+	wait = spaces_view->last_refresh + config.spaces_refresh_ms - mstime();
+	return wait > 0 ? (int)wait : 0;
 }
 
 int
 spaces_get_workspace_at_point(int x, int y)
 {
 	int grid_i, grid_j, ws;
-	int cell_start_x, cell_start_y;
+	XRectangle *r;
 	
-	/* Check if point is within grid area */
-	if (x < spaces_view.margin || x > DisplayWidth(dpy, spaces_view.screen->num) - spaces_view.margin ||
-	    y < spaces_view.margin || y > DisplayHeight(dpy, spaces_view.screen->num) - spaces_view.margin) {
+	/* Calculate which grid cell we're in */
+	if (x < spaces_view->margin + 10 || y < spaces_view->margin + 10)
 		return -1;
-	}
+	grid_j = (x - spaces_view->margin - 10) / spaces_view->grid_x;
+	grid_i = (y - spaces_view->margin - 10) / spaces_view->grid_y;
 	
-	/* Calculate which grid cell we're in */
-	grid_j = (x - spaces_view.margin - 10) / spaces_view.grid_x;
-	grid_i = (y - spaces_view.margin - 10) / spaces_view.grid_y;
+	if (grid_i >= spaces_view->visible_rows || grid_j >= spaces_view->cols)
+		return -1;
 	
-	if (grid_i < 0 || grid_i >= SPACES_GRID_SIZE || 
-	    grid_j < 0 || grid_j >= SPACES_GRID_SIZE) {
+	ws = (spaces_view->first_row + grid_i) * spaces_view->cols + grid_j;
+	if (ws >= workspace_count)
 		return -1;
-	}
 	
 	/* Check if we're actually within the cell bounds */
-	cell_start_x = spaces_view.margin + grid_j * spaces_view.grid_x + 10;
-	cell_start_y = spaces_view.margin + grid_i * spaces_view.grid_y + 10;
-	
-	if (x < cell_start_x || x > cell_start_x + spaces_view.cell_width ||
-	    y < cell_start_y || y > cell_start_y + spaces_view.cell_height) {
+	r = &spaces_view->cell[ws];
+	if (x > r->x + r->width || y > r->y + r->height)
 		return -1;
-	}
 	
-	ws = grid_i * SPACES_GRID_SIZE + grid_j;
-	
-	/* Return workspace number (0-8) regardless of validity - 
-	   caller will check if it's valid */
 	return ws;
 }
 
@@ -323,56 +812,17 @@ Client*
 spaces_get_client_at_point(int x, int y, int ws)
 {
 	Client *c;
-	int ws_x, ws_y, ws_width, ws_height;
-	int content_x, content_y, content_width, content_height;
-	int thumb_x, thumb_y, thumb_width, thumb_height;
-	int screen_width, screen_height;
-	double scale_x, scale_y;
-	int grid_i, grid_j;
+	XRectangle *r;
 	
-	if (ws < 0 || ws >= workspace_count)
+	if (ws < 0 || ws >= workspace_count || !spaces_visible(ws))
 		return NULL;
 	
-	/* Calculate workspace cell position */
-	grid_i = ws / SPACES_GRID_SIZE;
-	grid_j = ws % SPACES_GRID_SIZE;
-	ws_x = spaces_view.margin + grid_j * spaces_view.grid_x + 10;
-	ws_y = spaces_view.margin + grid_i * spaces_view.grid_y + 10;
-	ws_width = spaces_view.cell_width;
-	ws_height = spaces_view.cell_height;
-	
-	/* Calculate content area (exclude label area) */
-	content_x = ws_x + 2;
-	content_y = ws_y + (font ? font->ascent + font->descent + 10 : 20);
-	content_width = ws_width - 4;
-	content_height = ws_height - (content_y - ws_y) - 2;
-	
-	if (content_width <= 0 || content_height <= 0)
-		return NULL;
-		
-	screen_width = DisplayWidth(dpy, spaces_view.screen->num);
-	screen_height = DisplayHeight(dpy, spaces_view.screen->num);
-	
-	/* Calculate scaling factors */
-	scale_x = (double)content_width / screen_width;
-	scale_y = (double)content_height / screen_height;
-	
-	/* Check each client in this workspace */
+	/* Thumbnails remember where they were last drawn */
 	for (c = workspaces[ws].clients; c; c = c->workspace_next) {
-		if (normal(c)) {
-			/* Calculate thumbnail position and size */
-			thumb_x = content_x + (int)(c->x * scale_x);
-			thumb_y = content_y + (int)(c->y * scale_y);
-			thumb_width = (int)(c->dx * scale_x);
-			thumb_height = (int)(c->dy * scale_y);
-			
-			/* Minimum size for visibility */
-			if (thumb_width < 2) thumb_width = 2;
-			if (thumb_height < 2) thumb_height = 2;
-			
-			/* Check if point is within this thumbnail */
-			if (x >= thumb_x && x <= thumb_x + thumb_width &&
-			    y >= thumb_y && y <= thumb_y + thumb_height) {
+		if (normal(c) && c->screen == spaces_view->screen) {
+			r = &c->thumb_rect;
+			if (r->width && x >= r->x && x <= r->x + r->width &&
+			    y >= r->y && y <= r->y + r->height) {
 				return c;
 			}
 		}
@@ -388,15 +838,21 @@ spaces_handle_button(XButtonEvent *e)
 	Client *c;
 	
 	if (e->type == ButtonPress) {
-		if (e->button == Button3) {
+		if (e->button == Button4 || e->button == Button5) {
+			/* Wheel scrolls the grid a row at a time, also while dragging */
+			spaces_scroll(e->button == Button4 ? -1 : 1);
+		} else if (e->button == Button3) {
 			/* Right-click: start drag operation */
 			ws = spaces_get_workspace_at_point(e->x, e->y);
 			if (ws >= 0 && ws < workspace_count) {
 				c = spaces_get_client_at_point(e->x, e->y, ws);
 				if (c) {
-					spaces_view.drag_active = 1;
-					spaces_view.drag_client = c;
-					spaces_view.drag_start_ws = ws;
+					spaces_view->drag_active = 1;
+					spaces_view->drag_client = c;
+					spaces_view->drag_start_ws = ws;
+					/* Lift the thumbnail out of its cell */
+					spaces_mark(ws);
+					spaces_draw_cells();
 					/* Don't exit spaces mode during drag */
 					return;
 				}
@@ -406,35 +862,38 @@ spaces_handle_button(XButtonEvent *e)
 			ws = spaces_get_workspace_at_point(e->x, e->y);
 			if (ws >= 0 && ws < workspace_count) {
 				if (ws != current_workspace) {
-					workspace_switch(ws);
+					workspace_switch(spaces_view->screen, ws);
 				}
 				/* Always exit spaces mode when clicking on a valid workspace */
 				spaces_hide();
 			}
 		}
 	} else if (e->type == ButtonRelease) {
-		if (spaces_view.drag_active && e->button == Button3) {
+		if (spaces_view->drag_active && e->button == Button3) {
 			/* End drag operation */
 			ws = spaces_get_workspace_at_point(e->x, e->y);
-			if (ws >= 0 && ws < workspace_count && ws != spaces_view.drag_start_ws) {
+			if (ws >= 0 && ws < workspace_count && ws != spaces_view->drag_start_ws) {
 				/* Move window to target workspace */
 				fprintf(stderr, "spaces: dragging client %p from workspace %d to %d\n", 
-					(void*)spaces_view.drag_client, spaces_view.drag_start_ws, ws);
-				workspace_move_client(spaces_view.drag_client, ws);
+					(void*)spaces_view->drag_client, spaces_view->drag_start_ws, ws);
+				workspace_move_client(spaces_view->drag_client, ws);
 				/* Rebuild menu since workspace contents have changed */
 				rebuild_menu();
-				spaces_draw(); /* Redraw to show new layout */
+				spaces_mark(ws);
 				fprintf(stderr, "spaces: drag operation completed\n");
 			} else {
 				fprintf(stderr, "spaces: drag operation cancelled or invalid target\n");
 			}
+			/* Only the source cell and the highlighted target change */
+			spaces_mark(spaces_view->drag_start_ws);
+			spaces_mark(spaces_view->selected_workspace);
 			/* Reset drag state */
-			spaces_view.drag_active = 0;
-			spaces_view.drag_client = NULL;
-			spaces_view.drag_start_ws = -1;
-			spaces_view.selected_workspace = current_workspace;
+			spaces_view->drag_active = 0;
+			spaces_view->drag_client = NULL;
+			spaces_view->drag_start_ws = -1;
+			spaces_view->selected_workspace = current_workspace;
 			/* Redraw to clear any drag highlights */
-			spaces_draw();
+			spaces_draw_cells();
 		}
 	}
 }
@@ -442,20 +901,29 @@ spaces_handle_button(XButtonEvent *e)
 void
 spaces_handle_motion(XMotionEvent *e)
 {
+	XEvent ev;
 	int ws;
 	
-	if (spaces_view.drag_active) {
+	/* Only the newest pointer position matters, short of the next other event */
+	ev.xmotion = *e;
+	motion_compress(&ev);
+	e = &ev.xmotion;
+	
+	if (spaces_view->drag_active) {
 		/* Update highlight for drag target */
 		ws = spaces_get_workspace_at_point(e->x, e->y);
-		if (ws >= 0 && ws != spaces_view.selected_workspace) {
-			spaces_view.selected_workspace = ws;
-			spaces_draw(); /* Redraw to show drag feedback */
+		if (ws >= 0 && ws != spaces_view->selected_workspace) {
+			/* Move the highlight: only the old and new target cells change */
+			spaces_mark(spaces_view->selected_workspace);
+			spaces_mark(ws);
+			spaces_view->selected_workspace = ws;
+			spaces_draw_cells(); /* Redraw to show drag feedback */
 		}
 	} else {
 		/* Normal hover highlighting */
 		ws = spaces_get_workspace_at_point(e->x, e->y);
-		if (ws >= 0 && ws != spaces_view.selected_workspace) {
-			spaces_view.selected_workspace = ws;
+		if (ws >= 0 && ws != spaces_view->selected_workspace) {
+			spaces_view->selected_workspace = ws;
 		}
 	}
 }
@@ -467,22 +935,30 @@ spaces_handle_key(XKeyEvent *e)
 	
 	switch (keysym) {
 	case XK_Escape:
-		if (spaces_view.drag_active) {
+		if (spaces_view->drag_active) {
 			/* Cancel drag operation */
-			spaces_view.drag_active = 0;
-			spaces_view.drag_client = NULL;
-			spaces_view.drag_start_ws = -1;
-			spaces_view.selected_workspace = current_workspace;
-			spaces_draw();
+			spaces_mark(spaces_view->drag_start_ws);
+			spaces_mark(spaces_view->selected_workspace);
+			spaces_view->drag_active = 0;
+			spaces_view->drag_client = NULL;
+			spaces_view->drag_start_ws = -1;
+			spaces_view->selected_workspace = current_workspace;
+			spaces_draw_cells();
 		} else {
 			spaces_hide();
 		}
 		break;
+	case XK_Prior:
+		spaces_scroll(-spaces_view->visible_rows);
+		break;
+	case XK_Next:
+		spaces_scroll(spaces_view->visible_rows);
+		break;
 	case XK_Return:
 		/* Switch to selected workspace and exit */
-		if (spaces_view.selected_workspace >= 0 && 
-		    spaces_view.selected_workspace != current_workspace) {
-			workspace_switch(spaces_view.selected_workspace);
+		if (spaces_view->selected_workspace >= 0 && 
+		    spaces_view->selected_workspace != current_workspace) {
+			workspace_switch(spaces_view->screen, spaces_view->selected_workspace);
 		}
 		spaces_hide();
 		break;
@@ -7,27 +7,42 @@
 #define SPACES_H
 
 #include <X11/Xlib.h>
+#include "workspace.h"
 
-#define SPACES_GRID_SIZE 3
-#define SPACES_MAX_WORKSPACES 9
+/* Cells never get smaller than this; beyond that the grid scrolls */
+#define SPACES_MIN_CELL_WIDTH 160
+#define SPACES_MIN_CELL_HEIGHT 120
 
 typedef struct SpacesView SpacesView;
 
 struct SpacesView {
 	ScreenInfo *screen;
 	Window overlay;
+	Pixmap buffer;              /* Back buffer the overlay is copied from */
+	int x, y, width, height;    /* Monitor the overlay covers */
+	char dirty[MAX_WORKSPACES]; /* Cells to repaint from the buffer */
+	int ndirty;
+	unsigned long sig[MAX_WORKSPACES]; /* Contents of each cell when last painted */
 	int active;
 	int grid_x, grid_y;          /* Grid position dimensions */
 	int cell_width, cell_height; /* Individual workspace cell size */
 	int margin;                  /* Border margin */
+	int cols, rows;              /* Grid size for workspace_count cells */
+	int visible_rows;            /* Rows that fit on screen at once */
+	int first_row;               /* Topmost visible row when scrolled */
+	XRectangle cell[MAX_WORKSPACES]; /* Cell rectangles of the visible rows */
+	int content_top;             /* Offset of the thumbnail area below a cell's label */
+	double scale_x, scale_y;     /* Screen to thumbnail scale */
 	int selected_workspace;      /* Currently highlighted workspace */
 	int drag_active;            /* Whether dragging a window */
 	Client *drag_client;        /* Client being dragged */
 	int drag_start_ws;          /* Starting workspace for drag */
+	int refresh_pending;        /* Damaged thumbnails waiting for a refresh */
+	long last_refresh;          /* mstime() of the last thumbnail refresh */
 };
 
 /* Global spaces state */
-extern SpacesView spaces_view;
+extern SpacesView *spaces_view;	/* Of the screen spaces is open on or last used on */
 extern int spaces_mode;
 
 /* Function prototypes */
@@ -35,6 +50,11 @@ void spaces_init(ScreenInfo *s);
 void spaces_show(ScreenInfo *s);
 void spaces_hide(void);
 void spaces_draw(void);
+void spaces_draw_cells(void);
+void spaces_expose(XExposeEvent *e);
+void spaces_prerender(void);
+void spaces_reset(void);
+void spaces_scroll(int rows);
 void spaces_handle_button(XButtonEvent *e);
 void spaces_handle_motion(XMotionEvent *e);
 void spaces_handle_key(XKeyEvent *e);
@@ -42,5 +62,8 @@ int spaces_get_workspace_at_point(int x, int y);
 Client* spaces_get_client_at_point(int x, int y, int ws);
 void spaces_draw_workspace(int ws, int x, int y, int width, int height);
 void spaces_draw_window_thumbnail(Client *c, int ws_x, int ws_y, int ws_width, int ws_height);
+void spaces_damage(XEvent *ev);
+void spaces_refresh(void);
+int spaces_refresh_timeout(void);
 
 #endif /* SPACES_H */
\ No newline at end of file
@@ -0,0 +1,575 @@
+/*
+ * Window thumbnails for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ *
+ * With DAMAGE compiled in, frames of visible clients are redirected
+ * (automatic mode, so the server keeps painting them) while spaces is
+ * open, and their contents are scaled into the overview with Render.
+ * A Damage object per frame tells us which thumbnails went stale.
+ *
+ * Without Composite, but with SHM compiled in, the screen is grabbed
+ * with XShmGetImage just before spaces maps its overlay, each visible
+ * frame is box-filtered down on the CPU and uploaded with XShmPutImage.
+ *
+ * Either way the scaled result lands in a pixmap in the thumbnail cache.
+ * Entries belong to a client and remember the damage generation they
+ * were made from; drawing a thumbnail whose generation is unchanged is
+ * a plain XCopyArea.  Least recently drawn entries are freed once the
+ * pixmaps add up to more than thumb_cache_kb.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/X.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#ifdef DAMAGE
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xdamage.h>
+#include <X11/extensions/Xrender.h>
+#endif
+#ifdef SHM
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/extensions/XShm.h>
+#include "scale.h"
+#endif
+#include "dat.h"
+#include "fns.h"
+#include "config.h"
+#include "workspace.h"
+#include "thumb.h"
+
+int thumb_enabled = 0;
+int thumb_damage_event = -1;
+int thumb_shm = 0;
+
+struct ThumbEntry {
+	Client *c;
+	Pixmap pixmap;
+	int width, height;
+	int filled;                 /* Pixmap holds contents at all */
+	unsigned long gen;          /* c->damage_gen they were made from */
+	unsigned long bytes;
+	ThumbEntry *prev, *next;    /* LRU list, most recently drawn first */
+};
+
+static ThumbEntry *lru_head, *lru_tail;
+static ThumbCacheStats stats;
+
+#ifdef SHM
+typedef struct ThumbImage ThumbImage;
+
+struct ThumbImage {
+	XImage *image;
+	XShmSegmentInfo shm;
+};
+
+static ThumbImage capture;      /* The whole screen, as spaces opened */
+static ThumbImage upload;       /* Scaled pixels on their way to cache pixmaps */
+static int capture_valid;
+static int upload_x, upload_y, upload_row;	/* Next free spot in upload */
+#endif
+
+#if defined(DAMAGE) || defined(SHM)
+/* Outer size of c's frame as created in manage(), including the X border */
+static void
+thumb_frame_size(Client *c, int *fw, int *fh)
+{
+	*fw = c->dx + 2 * (BORDER - 1) + 2 * config.window_frame_width;
+	*fh = c->dy + 2 * (BORDER - 1) + 2 * config.window_frame_width;
+	if (config.show_titlebars)
+		*fh += config.titlebar_height;
+}
+#endif
+
+static void
+lru_unlink(ThumbEntry *e)
+{
+	if (e->prev)
+		e->prev->next = e->next;
+	else
+		lru_head = e->next;
+	if (e->next)
+		e->next->prev = e->prev;
+	else
+		lru_tail = e->prev;
+	e->prev = e->next = NULL;
+}
+
+static void
+lru_push(ThumbEntry *e)
+{
+	e->prev = NULL;
+	e->next = lru_head;
+	if (lru_head)
+		lru_head->prev = e;
+	lru_head = e;
+	if (lru_tail == NULL)
+		lru_tail = e;
+}
+
+static void
+entry_free(ThumbEntry *e)
+{
+	lru_unlink(e);
+	XFreePixmap(dpy, e->pixmap);
+	stats.bytes -= e->bytes;
+	stats.entries--;
+	e->c->thumb_entry = NULL;
+	free(e);
+}
+
+/* Drop least recently drawn entries, but never keep, until under the cap */
+static void
+cache_trim(ThumbEntry *keep)
+{
+	unsigned long cap;
+
+	cap = (unsigned long) config.thumb_cache_kb * 1024;
+	while (stats.bytes > cap && lru_tail && lru_tail != keep) {
+		entry_free(lru_tail);
+		stats.evictions++;
+	}
+}
+
+/*
+ * The entry for c with a pixmap of the given size, most recent in the
+ * LRU.  It only counts against the cap once the caller has filled it.
+ */
+static ThumbEntry*
+cache_get(Client *c, int width, int height)
+{
+	ThumbEntry *e;
+	int depth;
+
+	e = c->thumb_entry;
+	if (e && (e->width != width || e->height != height)) {
+		entry_free(e);
+		e = NULL;
+	}
+	if (e) {
+		lru_unlink(e);
+		lru_push(e);
+		return e;
+	}
+
+	e = (ThumbEntry *) calloc(1, sizeof(ThumbEntry));
+	if (e == NULL)
+		return NULL;
+	depth = DefaultDepth(dpy, c->screen->num);
+	e->c = c;
+	e->width = width;
+	e->height = height;
+	e->pixmap = XCreatePixmap(dpy, c->screen->root, width, height, depth);
+	e->bytes = (unsigned long) width * height * (depth > 16 ? 4 : depth > 8 ? 2 : 1);
+	c->thumb_entry = e;
+	lru_push(e);
+	stats.bytes += e->bytes;
+	stats.entries++;
+	return e;
+}
+
+#ifdef SHM
+static int
+image_create(ThumbImage *t, Screen *scr, int width, int height)
+{
+	t->image = XShmCreateImage(dpy, DefaultVisualOfScreen(scr), DefaultDepthOfScreen(scr),
+	                           ZPixmap, NULL, &t->shm, width, height);
+	if (t->image == NULL)
+		return 0;
+	if (t->image->bits_per_pixel != 32) {
+		/* The scaler only knows 32 bit pixels */
+		XDestroyImage(t->image);
+		t->image = NULL;
+		return 0;
+	}
+	t->shm.shmid = shmget(IPC_PRIVATE, t->image->bytes_per_line * height, IPC_CREAT | 0600);
+	if (t->shm.shmid < 0) {
+		XDestroyImage(t->image);
+		t->image = NULL;
+		return 0;
+	}
+	t->shm.shmaddr = t->image->data = (char *) shmat(t->shm.shmid, NULL, 0);
+	t->shm.readOnly = False;
+	if (t->shm.shmaddr == (char *) -1 || !XShmAttach(dpy, &t->shm)) {
+		if (t->shm.shmaddr != (char *) -1)
+			shmdt(t->shm.shmaddr);
+		shmctl(t->shm.shmid, IPC_RMID, NULL);
+		t->image->data = NULL;
+		XDestroyImage(t->image);
+		t->image = NULL;
+		return 0;
+	}
+	/* The segment goes away by itself once both sides have detached */
+	XSync(dpy, False);
+	shmctl(t->shm.shmid, IPC_RMID, NULL);
+	return 1;
+}
+
+static void
+image_destroy(ThumbImage *t)
+{
+	if (t->image == NULL)
+		return;
+	XShmDetach(dpy, &t->shm);
+	shmdt(t->shm.shmaddr);
+	t->image->data = NULL;
+	XDestroyImage(t->image);
+	t->image = NULL;
+}
+#endif
+
+static int
+thumb_init_shm(void)
+{
+#ifdef SHM
+	if (!XShmQueryExtension(dpy)) {
+		fprintf(stderr, "thumb: MIT-SHM not available, using plain thumbnails\n");
+		return 0;
+	}
+	thumb_shm = 1;
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+int
+thumb_init(void)
+{
+#ifdef DAMAGE
+	int event_base, error_base;
+	int major = 0, minor = 2;
+
+	if (!XCompositeQueryExtension(dpy, &event_base, &error_base) ||
+	    !XCompositeQueryVersion(dpy, &major, &minor) ||
+	    (major == 0 && minor < 2)) {
+		fprintf(stderr, "thumb: Composite 0.2 not available\n");
+		return thumb_init_shm();
+	}
+	if (!XRenderQueryExtension(dpy, &event_base, &error_base)) {
+		fprintf(stderr, "thumb: Render not available\n");
+		return thumb_init_shm();
+	}
+	if (!XDamageQueryExtension(dpy, &event_base, &error_base)) {
+		fprintf(stderr, "thumb: Damage not available\n");
+		return thumb_init_shm();
+	}
+	thumb_damage_event = event_base + XDamageNotify;
+	thumb_enabled = 1;
+	return 1;
+#else
+	return thumb_init_shm();
+#endif
+}
+
+void
+thumb_track(Client *c)
+{
+#ifdef DAMAGE
+	if (!thumb_enabled || c->damage != None || c->parent == c->screen->root)
+		return;
+
+	XCompositeRedirectWindow(dpy, c->parent, CompositeRedirectAutomatic);
+	c->damage = XDamageCreate(dpy, c->parent, XDamageReportNonEmpty);
+	/* Whatever is cached was made while we were not watching */
+	c->damage_gen++;
+	c->thumb_dirty = 1;
+#endif
+}
+
+void
+thumb_untrack(Client *c)
+{
+#ifdef DAMAGE
+	if (c->damage == None)
+		return;
+
+	XDamageDestroy(dpy, c->damage);
+	XCompositeUnredirectWindow(dpy, c->parent, CompositeRedirectAutomatic);
+	c->damage = None;
+	c->thumb_dirty = 0;
+#endif
+}
+
+/* Drop everything kept for c; it is going away */
+void
+thumb_free(Client *c)
+{
+	thumb_untrack(c);
+	if (c->thumb_entry)
+		entry_free(c->thumb_entry);
+}
+
+/*
+ * Grab the whole of s while nothing covers it, for thumb_draw() to scale
+ * thumbnails of the current workspace from.  Only used without Composite.
+ */
+int
+thumb_capture(ScreenInfo *s)
+{
+#ifdef SHM
+	Screen *scr;
+	Client *c;
+
+	if (!thumb_shm)
+		return 0;
+	scr = ScreenOfDisplay(dpy, s->num);
+	if (capture.image && (capture.image->width != WidthOfScreen(scr) ||
+	    capture.image->height != HeightOfScreen(scr)))
+		image_destroy(&capture);
+	if (capture.image == NULL &&
+	    !image_create(&capture, scr, WidthOfScreen(scr), HeightOfScreen(scr))) {
+		fprintf(stderr, "thumb: cannot create shared capture image, using plain thumbnails\n");
+		thumb_shm = 0;
+		return 0;
+	}
+	if (!XShmGetImage(dpy, s->root, capture.image, 0, 0, AllPlanes))
+		return 0;
+	capture_valid = 1;
+	/* That was a round trip, so every earlier upload has been read */
+	upload_x = upload_y = upload_row = 0;
+
+	/* Everything on screen has just been seen again */
+	for (c = clients; c; c = c->next) {
+		if (normal(c) && c->screen == s && workspace_shown(c))
+			c->damage_gen++;
+	}
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* The screen has moved on; keep the cached thumbnails but stop rescaling */
+void
+thumb_capture_end(void)
+{
+#ifdef SHM
+	capture_valid = 0;
+#endif
+}
+
+Client*
+thumb_handle_damage(XEvent *ev)
+{
+#ifdef DAMAGE
+	XDamageNotifyEvent *e = (XDamageNotifyEvent *) ev;
+	Client *c;
+
+	/* We only ever want to know "something changed", so swallow the region */
+	XDamageSubtract(dpy, e->damage, None, None);
+
+	c = getclient(e->drawable, 0);
+	if (c == 0 || c->damage != e->damage)
+		return NULL;
+
+	c->damage_gen++;
+	c->thumb_dirty = 1;
+	return c;
+#else
+	return NULL;
+#endif
+}
+
+#ifdef DAMAGE
+/* Scale the redirected contents of c's frame into e's pixmap */
+static int
+thumb_render_composite(Client *c, ThumbEntry *e)
+{
+	XRenderPictFormat *format;
+	XRenderPictureAttributes pa;
+	XTransform xform;
+	Pixmap pixmap;
+	Picture src, dst;
+	int fw, fh;
+
+	if (c->damage == None || !workspace_shown(c))
+		return 0;
+
+	format = XRenderFindVisualFormat(dpy, DefaultVisual(dpy, c->screen->num));
+	if (format == NULL)
+		return 0;
+
+	thumb_frame_size(c, &fw, &fh);
+
+	memset(&pa, 0, sizeof(pa));
+	memset(&xform, 0, sizeof(xform));
+	xform.matrix[0][0] = XDoubleToFixed((double) fw / e->width);
+	xform.matrix[1][1] = XDoubleToFixed((double) fh / e->height);
+	xform.matrix[2][2] = XDoubleToFixed(1.0);
+
+	pixmap = XCompositeNameWindowPixmap(dpy, c->parent);
+	src = XRenderCreatePicture(dpy, pixmap, format, 0, &pa);
+	XRenderSetPictureTransform(dpy, src, &xform);
+	XRenderSetPictureFilter(dpy, src, FilterBilinear, NULL, 0);
+	dst = XRenderCreatePicture(dpy, e->pixmap, format, 0, &pa);
+
+	XRenderComposite(dpy, PictOpSrc, src, None, dst,
+	                 0, 0, 0, 0, 0, 0, e->width, e->height);
+
+	XRenderFreePicture(dpy, dst);
+	XRenderFreePicture(dpy, src);
+	XFreePixmap(dpy, pixmap);
+	return 1;
+}
+#endif
+
+#ifdef SHM
+/*
+ * A width x height spot in upload that no put still in flight reads from.
+ * Thumbnails are laid out in rows across it; only once it is full do we
+ * wait for the server, so a refresh costs one round trip, not one each.
+ */
+static unsigned int*
+upload_place(ScreenInfo *s, int width, int height, int *x, int *y)
+{
+	Screen *scr;
+	int w, h;
+
+	scr = ScreenOfDisplay(dpy, s->num);
+	if (upload.image && (upload.image->width < width || upload.image->height < height))
+		image_destroy(&upload);
+	if (upload.image == NULL) {
+		w = WidthOfScreen(scr) > width ? WidthOfScreen(scr) : width;
+		h = HeightOfScreen(scr) / 2 > height ? HeightOfScreen(scr) / 2 : height;
+		if (!image_create(&upload, scr, w, h))
+			return NULL;
+		upload_x = upload_y = upload_row = 0;
+	}
+	if (upload_x + width > upload.image->width) {
+		upload_x = 0;
+		upload_y += upload_row;
+		upload_row = 0;
+	}
+	if (upload_y + height > upload.image->height) {
+		XSync(dpy, False);
+		upload_x = upload_y = upload_row = 0;
+	}
+	*x = upload_x;
+	*y = upload_y;
+	upload_x += width;
+	if (height > upload_row)
+		upload_row = height;
+	return (unsigned int *) upload.image->data + (long) *y * (upload.image->bytes_per_line / 4) + *x;
+}
+
+/*
+ * Scale c's frame out of the last screen capture into e's pixmap.  Of a
+ * frame partly off screen only the part on it is scaled, into the same
+ * part of the thumbnail; the rest is left black.
+ */
+static int
+thumb_render_shm(Client *c, ThumbEntry *e)
+{
+	unsigned int *dst;
+	int ox, oy, fx, fy, fw, fh, full_w, full_h, stride, dstride;
+	int x0, y0, x1, y1, ux, uy, y;
+
+	if (!capture_valid || !workspace_shown(c))
+		return 0;
+
+	thumb_frame_size(c, &full_w, &full_h);
+	ox = fx = c->x - BORDER;
+	oy = fy = c->y - BORDER;
+	fw = full_w;
+	fh = full_h;
+	if (fx < 0) { fw += fx; fx = 0; }
+	if (fy < 0) { fh += fy; fy = 0; }
+	if (fx + fw > capture.image->width)
+		fw = capture.image->width - fx;
+	if (fy + fh > capture.image->height)
+		fh = capture.image->height - fy;
+	if (fw <= 0 || fh <= 0)
+		return 0;
+
+	/* Where the part on screen falls in the thumbnail */
+	x0 = (long) (fx - ox) * e->width / full_w;
+	y0 = (long) (fy - oy) * e->height / full_h;
+	x1 = (long) (fx - ox + fw) * e->width / full_w;
+	y1 = (long) (fy - oy + fh) * e->height / full_h;
+	if (x1 <= x0 || y1 <= y0)
+		return 0;
+
+	dst = upload_place(c->screen, e->width, e->height, &ux, &uy);
+	if (dst == NULL)
+		return 0;
+	dstride = upload.image->bytes_per_line / 4;
+	if (x0 > 0 || y0 > 0 || x1 < e->width || y1 < e->height)
+		for (y = 0; y < e->height; y++)
+			memset(dst + (long) y * dstride, 0, e->width * sizeof(unsigned int));
+
+	stride = capture.image->bytes_per_line / 4;
+	scale_box((unsigned int *) capture.image->data + (long) fy * stride + fx, fw, fh, stride,
+	          dst + (long) y0 * dstride + x0, x1 - x0, y1 - y0, dstride);
+	XShmPutImage(dpy, e->pixmap, c->screen->copy_gc, upload.image,
+	             ux, uy, 0, 0, e->width, e->height, False);
+	return 1;
+}
+#endif
+
+static int
+thumb_render(Client *c, ThumbEntry *e)
+{
+#ifdef DAMAGE
+	if (thumb_enabled)
+		return thumb_render_composite(c, e);
+#endif
+#ifdef SHM
+	if (thumb_shm)
+		return thumb_render_shm(c, e);
+#endif
+	return 0;
+}
+
+/*
+ * Draw c's thumbnail so the whole frame maps onto r, painting only the
+ * part of r inside clip.  Returns 0 if we have no contents for c and
+ * the caller should draw a plain thumbnail instead.
+ */
+int
+thumb_draw(Client *c, Drawable d, XRectangle *r, XRectangle *clip)
+{
+	ThumbEntry *e;
+
+	if (!thumb_enabled && !thumb_shm)
+		return 0;
+	if (!normal(c) || r->width == 0 || r->height == 0 || clip->width == 0 || clip->height == 0)
+		return 0;
+
+	e = c->thumb_entry;
+	if (e && e->filled && e->gen == c->damage_gen &&
+	    e->width == r->width && e->height == r->height) {
+		stats.hits++;
+		lru_unlink(e);
+		lru_push(e);
+	} else {
+		stats.misses++;
+		e = cache_get(c, r->width, r->height);
+		if (e == NULL)
+			return 0;
+		if (thumb_render(c, e)) {
+			e->gen = c->damage_gen;
+			e->filled = 1;
+			cache_trim(e);
+		} else if (!e->filled) {
+			/* Never captured, so it must not push out thumbnails that were */
+			entry_free(e);
+			return 0;
+		}
+		/* Else, off-screen, it keeps what it looked like when last seen */
+	}
+
+	XCopyArea(dpy, e->pixmap, d, c->screen->copy_gc,
+	          clip->x - r->x, clip->y - r->y, clip->width, clip->height, clip->x, clip->y);
+	c->thumb_dirty = 0;
+	return 1;
+}
+
+void
+thumb_cache_stats(ThumbCacheStats *s)
+{
+	*s = stats;
+}
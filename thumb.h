@@ -0,0 +1,38 @@
+/*
+ * Window thumbnails for shrub9 (9wm fork)
+ * Copyright multiple authors, see README for licence details
+ */
+
+#ifndef THUMB_H
+#define THUMB_H
+
+#include <X11/Xlib.h>
+
+typedef struct ThumbEntry ThumbEntry;
+typedef struct ThumbCacheStats ThumbCacheStats;
+
+struct ThumbCacheStats {
+	unsigned long hits;         /* Drawn straight from the cache */
+	unsigned long misses;       /* Had to be (re)scaled first */
+	unsigned long evictions;    /* Dropped to stay under thumb_cache_kb */
+	unsigned long bytes;        /* Pixmap memory held right now */
+	int entries;
+};
+
+/* Global thumbnail state */
+extern int thumb_enabled;
+extern int thumb_damage_event;
+extern int thumb_shm;
+
+/* Function prototypes */
+int thumb_init(void);
+void thumb_track(Client *c);
+void thumb_untrack(Client *c);
+void thumb_free(Client *c);
+int thumb_capture(ScreenInfo *s);
+void thumb_capture_end(void);
+Client* thumb_handle_damage(XEvent *ev);
+int thumb_draw(Client *c, Drawable d, XRectangle *r, XRectangle *clip);
+void thumb_cache_stats(ThumbCacheStats *s);
+
+#endif /* THUMB_H */
@@ -12,6 +12,8 @@
 #include "fns.h"
 #include "workspace.h"
 #include "config.h"
+#include "layout.h"
+#include "monitor.h"
 
 Workspace workspaces[MAX_WORKSPACES];
 int current_workspace = 0;
@@ -36,7 +38,7 @@ client_exists_in_global_list(Client *target)
 void
 workspace_init(int count)
 {
-	int i;
+	int i, layout;
 	
 	fprintf(stderr, "workspace_init: initializing with count=%d\n", count);
 	
@@ -48,47 +50,77 @@ workspace_init(int count)
 	workspace_count = count;
 	fprintf(stderr, "workspace_init: final workspace_count=%d\n", workspace_count);
 	
+	if ((layout = layout_find(config.tile_layout)) < 0)
+		layout = 0;
 	for (i = 0; i < MAX_WORKSPACES; i++) {
 		workspaces[i].id = i;
 		workspaces[i].clients = NULL;
 		workspaces[i].current_client = NULL;
 		workspaces[i].visible = (i == 0) ? 1 : 0;
+		workspaces[i].layout = layout;
+		workspaces[i].autotile = config.auto_tile;
 	}
 	
 	current_workspace = 0;
 }
 
+/* Whether ws is shown on any head, for workspaces[ws].visible */
+static int
+workspace_on_screen(int ws)
+{
+	int i, k;
+	
+	for (i = 0; i < num_screens; i++)
+		for (k = 0; k < screens[i].nmonitors; k++)
+			if (screens[i].monitors[k].workspace == ws)
+				return 1;
+	return 0;
+}
+
+/* Recompute workspaces[].visible after the heads have changed */
 void
-workspace_switch(int ws)
+workspace_update_visible(void)
 {
+	int ws;
+
+	for (ws = 0; ws < workspace_count; ws++)
+		workspaces[ws].visible = workspace_on_screen(ws);
+}
+
+/*
+ * Show workspace ws on head m.  Only the windows on m are mapped or
+ * unmapped; the other heads keep showing what they were.
+ */
+void
+workspace_show_on(Monitor *m, int ws)
+{
+	Client *c;
 	int old_ws;
 	
-	if (ws < 0 || ws >= workspace_count || ws == current_workspace)
+	if (m == 0 || ws < 0 || ws >= workspace_count || ws == m->workspace)
 		return;
 	
-	old_ws = current_workspace;
+	old_ws = m->workspace;
 	
 	fprintf(stderr, "workspace_switch: switching from workspace %d to %d\n", old_ws, ws);
 	
 	/* Set flag to prevent workspace removal during switching */
 	workspace_switching = 1;
 	
-	workspace_hide_all_clients(old_ws);
-	workspaces[old_ws].visible = 0;
-	
-	current_workspace = ws;
-	workspace_show_all_clients(ws);
-	workspaces[current_workspace].visible = 1;
+	workspace_hide_all_clients(old_ws, m);
+	m->workspace = ws;
+	workspace_show_all_clients(ws, m);
+	workspaces[old_ws].visible = workspace_on_screen(old_ws);
 	
 	/* Rebuild menu since hidden clients may have changed */
 	rebuild_menu();
 	
-	if (workspaces[ws].current_client) {
-		active(workspaces[ws].current_client);
-	} else {
+	c = workspaces[ws].current_client;
+	if (c && monitor_of(c) == m) {
+		active(c);
+	} else if (current && monitor_of(current) == m) {
 		/* Set current to NULL without calling nofocus() to avoid grab issues */
-		if (current)
-			setactive(current, 0);
+		setactive(current, 0);
 		current = NULL;
 	}
 	
@@ -100,6 +132,44 @@ workspace_switch(int ws)
 	workspace_debug_dump();
 }
 
+/* Switch the focused head of s, and only that one, to workspace ws */
+void
+workspace_switch(ScreenInfo *s, int ws)
+{
+	Monitor *m;
+	
+	if (s == 0 || ws < 0 || ws >= workspace_count)
+		return;
+	m = monitor_focused(s);
+	current_workspace = ws;
+	workspace_show_on(m, ws);
+}
+
+/*
+ * c was moved or resized from head from.  It keeps its workspace, so
+ * when it landed on a head showing another one, that head follows it.
+ */
+void
+workspace_follow(Client *c, Monitor *from)
+{
+	Monitor *m;
+	
+	if (c == 0 || c->workspace < 0)
+		return;
+	m = monitor_of(c);
+	if (m == from || m->workspace == c->workspace)
+		return;
+	workspace_show_on(m, c->workspace);
+	current_workspace = c->workspace;
+}
+
+/* Whether c's workspace is the one shown on its head */
+int
+workspace_shown(Client *c)
+{
+	return c->workspace >= 0 && c->workspace == monitor_of(c)->workspace;
+}
+
 void
 workspace_add_client(Client *c, int ws)
 {
@@ -124,6 +194,7 @@ workspace_add_client(Client *c, int ws)
 	}
 		
 	c->workspace = ws;
+	layout_touch(ws);
 	fprintf(stderr, "workspace_add_client: assigned c->workspace = %d\n", c->workspace);
 	head = &workspaces[ws].clients;
 	
@@ -189,6 +260,7 @@ workspace_remove_client(Client *c)
 	
 	if (workspaces[ws].current_client == c)
 		workspaces[ws].current_client = NULL;
+	layout_touch(ws);
 	
 	if (c->workspace_prev)
 		c->workspace_prev->workspace_next = c->workspace_next;
@@ -244,24 +316,13 @@ workspace_move_client(Client *c, int ws)
 	}
 	
 	/* Ensure proper visibility after move */
-	if (ws == current_workspace) {
-		/* Moving to current workspace - make sure it's visible */
-		if (c->state != WithdrawnState) {
-			XMapWindow(dpy, c->window);
-			XMapRaised(dpy, c->parent);
-			setwstate(c, NormalState);
-		}
+	if (workspace_shown(c)) {
+		/* Moving to the workspace on its head - make sure it's visible */
+		workspace_show_client(c);
 	} else {
-		/* Moving to non-current workspace - make sure it's hidden */
-		if (c->state != WithdrawnState) {
-			/* Set workspace switching protection to prevent withdrawal on UnmapNotify */
-			workspace_switching = 1;
-			pending_workspace_unmaps += 2;  /* parent + window */
-			fprintf(stderr, "workspace_move_client: setting protection for unmap events (pending=%d)\n", pending_workspace_unmaps);
-			
-			XUnmapWindow(dpy, c->parent);
-			XUnmapWindow(dpy, c->window);
-		}
+		/* Moving to a workspace not shown there - make sure it's hidden */
+		workspace_switching = 1;
+		workspace_hide_client(c);
 		/* If this was the current window, clear the global current */
 		if (c == current) {
 			setactive(current, 0);
@@ -276,8 +337,42 @@ workspace_get_current(void)
 	return current_workspace;
 }
 
+/* Map c again after a workspace switch hid it */
+void
+workspace_show_client(Client *c)
+{
+	if (c->state == WithdrawnState)
+		return;
+	/* Only map windows that should be visible (not in IconicState) */
+	if (c->state != IconicState) {
+		XMapWindow(dpy, c->window);
+		XMapRaised(dpy, c->parent);
+		setwstate(c, NormalState);
+		fprintf(stderr, "  mapped client %p\n", (void*)c);
+	} else {
+		/* Keep hidden windows hidden - don't map them */
+		fprintf(stderr, "  keeping client %p hidden (IconicState)\n", (void*)c);
+	}
+}
+
+/* Unmap c for a workspace switch; the caller sets workspace_switching */
 void
-workspace_show_all_clients(int ws)
+workspace_hide_client(Client *c)
+{
+	if (c->state == WithdrawnState)
+		return;
+	/* Simply hide the window - workspace switching flag prevents removal */
+	XUnmapWindow(dpy, c->parent);
+	XUnmapWindow(dpy, c->window);
+	/* Track this as a workspace switch unmap - we expect 2 UnmapNotify events per client
+	   (one for parent, one for window), so increment by 2 */
+	pending_workspace_unmaps += 2;
+	fprintf(stderr, "workspace_hide: unmapped client %p (switching flag protects from removal, pending=%d)\n", (void*)c, pending_workspace_unmaps);
+}
+
+/* Show the clients of ws that are on head m, or on every head when m is 0 */
+void
+workspace_show_all_clients(int ws, Monitor *m)
 {
 	Client *c;
 	int count = 0;
@@ -288,36 +383,27 @@ workspace_show_all_clients(int ws)
 	fprintf(stderr, "workspace_show_all_clients: showing clients in workspace %d\n", ws);
 		
 	for (c = workspaces[ws].clients; c; c = c->workspace_next) {
-		count++;
-		fprintf(stderr, "  client %d: %p (window=0x%lx, state=%d)\n", 
-			count, (void*)c, c->window, c->state);
-		
 		/* Validate client exists in global list */
 		if (!client_exists_in_global_list(c)) {
 			fprintf(stderr, "workspace_show_all_clients: invalid client %p in workspace %d\n", (void*)c, ws);
 			continue;
 		}
+		if (m && monitor_of(c) != m)
+			continue;
+		count++;
+		fprintf(stderr, "  client %d: %p (window=0x%lx, state=%d)\n", 
+			count, (void*)c, c->window, c->state);
 		
 		/* Show all clients that were hidden by workspace switching */
-		if (c->state != WithdrawnState) {
-			/* Only map windows that should be visible (not in IconicState) */
-			if (c->state != IconicState) {
-				XMapWindow(dpy, c->window);
-				XMapRaised(dpy, c->parent);
-				setwstate(c, NormalState);
-				fprintf(stderr, "  mapped client %p\n", (void*)c);
-			} else {
-				/* Keep hidden windows hidden - don't map them */
-				fprintf(stderr, "  keeping client %p hidden (IconicState)\n", (void*)c);
-			}
-		}
+		workspace_show_client(c);
 	}
 	workspaces[ws].visible = 1;
 	fprintf(stderr, "workspace_show_all_clients: showed %d clients in workspace %d\n", count, ws);
 }
 
+/* Hide the clients of ws that are on head m, or on every head when m is 0 */
 void
-workspace_hide_all_clients(int ws)
+workspace_hide_all_clients(int ws, Monitor *m)
 {
 	Client *c;
 	int count = 0;
@@ -328,27 +414,21 @@ workspace_hide_all_clients(int ws)
 	fprintf(stderr, "workspace_hide_all_clients: hiding clients in workspace %d\n", ws);
 		
 	for (c = workspaces[ws].clients; c; c = c->workspace_next) {
-		count++;
-		fprintf(stderr, "  hiding client %d: %p (window=0x%lx, state=%d)\n", 
-			count, (void*)c, c->window, c->state);
-		
 		/* Validate client exists in global list */
 		if (!client_exists_in_global_list(c)) {
 			fprintf(stderr, "workspace_hide_all_clients: invalid client %p in workspace %d\n", (void*)c, ws);
 			continue;
 		}
+		if (m && monitor_of(c) != m)
+			continue;
+		count++;
+		fprintf(stderr, "  hiding client %d: %p (window=0x%lx, state=%d)\n", 
+			count, (void*)c, c->window, c->state);
 		
-		if (c->state != WithdrawnState) {
-			/* Simply hide the window - workspace switching flag prevents removal */
-			XUnmapWindow(dpy, c->parent);
-			XUnmapWindow(dpy, c->window);
-			/* Track this as a workspace switch unmap - we expect 2 UnmapNotify events per client
-			   (one for parent, one for window), so increment by 2 */
-			pending_workspace_unmaps += 2;
-			fprintf(stderr, "workspace_hide: unmapped client %p (switching flag protects from removal, pending=%d)\n", (void*)c, pending_workspace_unmaps);
-		}
+		workspace_hide_client(c);
 	}
-	workspaces[ws].visible = 0;
+	if (m == 0)
+		workspaces[ws].visible = 0;
 	fprintf(stderr, "workspace_hide_all_clients: hid %d clients in workspace %d\n", count, ws);
 }
 
@@ -7,7 +7,7 @@
 #define WORKSPACE_H
 
 
-#define MAX_WORKSPACES 10
+#define MAX_WORKSPACES 128
 
 typedef struct Workspace Workspace;
 
@@ -16,21 +16,29 @@ struct Workspace {
 	Client *clients;
 	Client *current_client;
 	int visible;
+	int layout;		/* Index into layouts[], see layout.c */
+	int autotile;		/* Relayout as clients come and go */
 };
 
 extern Workspace workspaces[MAX_WORKSPACES];
-extern int current_workspace;
+extern int current_workspace;	/* Shown on the focused head */
 extern int workspace_count;
 
 /* Function prototypes */
 void workspace_init(int count);
-void workspace_switch(int ws);
+void workspace_switch(ScreenInfo *s, int ws);
+void workspace_show_on(Monitor *m, int ws);
+void workspace_update_visible(void);
+void workspace_follow(Client *c, Monitor *from);
+int workspace_shown(Client *c);
 void workspace_add_client(Client *c, int ws);
 void workspace_remove_client(Client *c);
 void workspace_move_client(Client *c, int ws);
 int workspace_get_current(void);
-void workspace_show_all_clients(int ws);
-void workspace_hide_all_clients(int ws);
+void workspace_show_client(Client *c);
+void workspace_hide_client(Client *c);
+void workspace_show_all_clients(int ws, Monitor *m);
+void workspace_hide_all_clients(int ws, Monitor *m);
 Client* workspace_get_next_client(int ws);
 void workspace_debug_dump(void);
 void workspace_check_switching_state(void);